@@ -0,0 +1,317 @@
+// Micro-benchmarks of the pipelines against the loops they stand for.
+//
+//   range_bench [--quick] [filter]
+//
+// Every case runs three ways: a hand-written loop, the pipeline driven by
+// forEach (the path that terminals take) and the pipeline walked with its
+// iterators. Terminals such as sum have no iterator path, their iterate
+// column is null. The results go to stdout as one JSON array, timings are
+// the best of several repetitions.
+#include "range.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Keeps the compiler from dropping a computation whose result is unused.
+template < typename T >
+void keep( const T& value ) {
+	asm volatile( "" : : "r,m"( value ) : "memory" );
+}
+
+struct Case {
+	std::string name;
+	std::string type;
+	size_t elements;
+	size_t bytes;
+	std::function< void() > loop;
+	std::function< void() > consume;
+	// Empty for terminals, which have no iterators to walk.
+	std::function< void() > iterate;
+};
+
+struct Settings {
+	double minSeconds = 0.05;
+	int repetitions = 5;
+	std::vector< size_t > sizes = { 1 << 10, 1 << 16, 1 << 20 };
+};
+
+// Best time of one call in seconds, each repetition runs the body often
+// enough to last minSeconds.
+double measure( const std::function< void() >& body, const Settings& settings ) {
+	using Clock = std::chrono::steady_clock;
+	size_t calls = 1;
+	while ( true ) {
+		auto start = Clock::now();
+		for ( size_t i = 0; i < calls; ++i ) {
+			body();
+		}
+		double elapsed = std::chrono::duration< double >( Clock::now() - start ).count();
+		if ( elapsed >= settings.minSeconds / 4 || calls >= ( size_t{ 1 } << 30 ) ) {
+			break;
+		}
+		calls *= 2;
+	}
+	calls = std::max< size_t >( 1, static_cast< size_t >( static_cast< double >( calls ) * 4 ) );
+
+	double best = 1e300;
+	for ( int r = 0; r < settings.repetitions; ++r ) {
+		auto start = Clock::now();
+		for ( size_t i = 0; i < calls; ++i ) {
+			body();
+		}
+		double elapsed = std::chrono::duration< double >( Clock::now() - start ).count();
+		best = std::min( best, elapsed / static_cast< double >( calls ) );
+	}
+	return best;
+}
+
+template < typename T > const char* typeName();
+template <> const char* typeName< std::int32_t >() { return "int32"; }
+template <> const char* typeName< std::int64_t >() { return "int64"; }
+template <> const char* typeName< float >() { return "float"; }
+template <> const char* typeName< double >() { return "double"; }
+
+template < typename T >
+std::vector< T > makeInput( size_t n ) {
+	std::vector< T > v( n );
+	for ( size_t i = 0; i < n; ++i ) {
+		v[ i ] = static_cast< T >( ( i * 7919 ) % 1000 ) - static_cast< T >( 500 );
+	}
+	return v;
+}
+
+// The same pipeline once through forEach and once through its iterators.
+template < typename MakePipeline >
+std::pair< std::function< void() >, std::function< void() > > bothWays( MakePipeline make ) {
+	auto consume = [make] {
+		decltype( *make().begin() + *make().begin() ) total{};
+		forEach( make(), [&]( auto x ) { total += x; } );
+		keep( total );
+	};
+	auto iterate = [make] {
+		auto pipeline = make();
+		decltype( *pipeline.begin() + *pipeline.begin() ) total{};
+		for ( auto it = pipeline.begin(); it != pipeline.end(); ++it ) {
+			total += *it;
+		}
+		keep( total );
+	};
+	return { consume, iterate };
+}
+
+template < typename T >
+void addCase( std::vector< Case >& cases, std::string name, size_t n, size_t bytes,
+		std::function< void() > loop, std::pair< std::function< void() >, std::function< void() > > pipeline ) {
+	cases.push_back( { std::move( name ), typeName< T >(), n, bytes, std::move( loop ),
+		std::move( pipeline.first ), std::move( pipeline.second ) } );
+}
+
+// Cases over containers of T, the inputs are shared by all of them.
+template < typename T >
+void addTypedCases( std::vector< Case >& cases, size_t n ) {
+	auto a = std::make_shared< std::vector< T > >( makeInput< T >( n ) );
+	auto b = std::make_shared< std::vector< T > >( makeInput< T >( n ) );
+	std::reverse( b->begin(), b->end() );
+	size_t bytes = n * sizeof( T );
+	auto affine = []( T x ) { return x * static_cast< T >( 3 ) + static_cast< T >( 1 ); };
+	auto positive = []( T x ) { return x > static_cast< T >( 0 ); };
+
+	addCase< T >( cases, "map", n, bytes,
+		[a, affine] {
+			T total{};
+			for ( T x : *a ) {
+				total += affine( x );
+			}
+			keep( total );
+		},
+		bothWays( [a, affine] { return *a | map( affine ); } ) );
+
+	addCase< T >( cases, "filter", n, bytes,
+		[a, positive] {
+			T total{};
+			for ( T x : *a ) {
+				if ( positive( x ) ) {
+					total += x;
+				}
+			}
+			keep( total );
+		},
+		bothWays( [a, positive] { return *a | filter( positive ); } ) );
+
+	addCase< T >( cases, "take", n / 2, bytes / 2,
+		[a, n] {
+			T total{};
+			for ( size_t i = 0; i < n / 2; ++i ) {
+				total += ( *a )[ i ];
+			}
+			keep( total );
+		},
+		bothWays( [a, n] { return *a | take( n / 2 ); } ) );
+
+	addCase< T >( cases, "zipWith", n, 2 * bytes,
+		[a, b, n] {
+			T total{};
+			for ( size_t i = 0; i < n; ++i ) {
+				total += ( *a )[ i ] * ( *b )[ i ];
+			}
+			keep( total );
+		},
+		bothWays( [a, b] { return zipWith( *a, *b, std::multiplies<>() ); } ) );
+
+	addCase< T >( cases, "zip", n, 2 * bytes,
+		[a, b, n] {
+			T total{};
+			for ( size_t i = 0; i < n; ++i ) {
+				total += ( *a )[ i ] - ( *b )[ i ];
+			}
+			keep( total );
+		},
+		bothWays( [a, b] { return zip( *a, *b ) | map( []( auto p ) { return p.first - p.second; } ); } ) );
+
+	addCase< T >( cases, "enumerate", n, bytes,
+		[a, n] {
+			T total{};
+			for ( size_t i = 0; i < n; ++i ) {
+				total += static_cast< T >( i ) * ( *a )[ i ];
+			}
+			keep( total );
+		},
+		bothWays( [a] { return enumerate( *a ) | map( []( auto p ) { return static_cast< T >( p.first ) * p.second; } ); } ) );
+
+	addCase< T >( cases, "map|filter|take", n, bytes,
+		[a, affine, positive, n] {
+			T total{};
+			size_t left = n / 4;
+			for ( size_t i = 0; i < n && left > 0; ++i ) {
+				T y = affine( ( *a )[ i ] );
+				if ( positive( y ) ) {
+					total += y;
+					--left;
+				}
+			}
+			keep( total );
+		},
+		bothWays( [a, affine, positive, n] { return *a | map( affine ) | filter( positive ) | take( n / 4 ); } ) );
+
+	auto affineSimd = []( auto x ) { return x * static_cast< T >( 3 ) + static_cast< T >( 1 ); };
+	auto affineLoop = [a, affine] {
+		T total{};
+		for ( T x : *a ) {
+			total += affine( x );
+		}
+		keep( total );
+	};
+	addCase< T >( cases, "mapSimd", n, bytes, affineLoop,
+		bothWays( [a, affineSimd] { return *a | mapSimd( affineSimd ); } ) );
+	cases.push_back( { "mapSimd|sum", typeName< T >(), n, bytes, affineLoop,
+		[a, affineSimd] { keep( *a | mapSimd( affineSimd ) | sum() ); }, {} } );
+
+	auto sumLoop = [a] {
+		T total{};
+		for ( T x : *a ) {
+			total += x;
+		}
+		keep( total );
+	};
+	cases.push_back( { "sum", typeName< T >(), n, bytes, sumLoop, [a] { keep( sum( *a ) ); }, {} } );
+	cases.push_back( { "sum pairwise", typeName< T >(), n, bytes, sumLoop,
+		[a] { keep( sum( *a, Summation::pairwise ) ); }, {} } );
+}
+
+// Cases that generate their elements instead of reading them.
+void addGeneratedCases( std::vector< Case >& cases, size_t n ) {
+	using T = std::int64_t;
+	auto cube = []( T x ) { return x * x * x; };
+
+	addCase< T >( cases, "range|map", n, 0,
+		[n, cube] {
+			T total{};
+			for ( T i = 0; i < static_cast< T >( n ); ++i ) {
+				total += cube( i );
+			}
+			keep( total );
+		},
+		bothWays( [n, cube] { return range( static_cast< T >( n ) ) | map( cube ); } ) );
+
+	addCase< T >( cases, "infiniteSequence|filter|take", n, 0,
+		[n] {
+			T total{};
+			size_t left = n;
+			for ( T i = 0; left > 0; ++i ) {
+				if ( i % 3 == 0 ) {
+					total += i;
+					--left;
+				}
+			}
+			keep( total );
+		},
+		bothWays( [n] { return infiniteSequence( T{ 0 } ) | filter( []( T x ) { return x % 3 == 0; } ) | take( n ); } ) );
+}
+
+// iterate is negative for cases without an iterator path.
+void printResult( const Case& c, double loop, double consume, double iterate, bool last ) {
+	auto nsPerElement = [&]( double seconds ) {
+		return c.elements == 0 ? 0.0 : seconds * 1e9 / static_cast< double >( c.elements );
+	};
+	auto gbPerSecond = [&]( double seconds ) {
+		return seconds == 0.0 ? 0.0 : static_cast< double >( c.bytes ) / seconds / 1e9;
+	};
+	std::printf( "  {\"name\": \"%s\", \"type\": \"%s\", \"elements\": %zu, \"bytes\": %zu,\n", c.name.c_str(), c.type.c_str(), c.elements, c.bytes );
+	std::printf( "   \"loop\": {\"ns_per_elem\": %.4f, \"gb_per_s\": %.3f},\n", nsPerElement( loop ), gbPerSecond( loop ) );
+	std::printf( "   \"consume\": {\"ns_per_elem\": %.4f, \"gb_per_s\": %.3f, \"vs_loop\": %.3f},\n",
+		nsPerElement( consume ), gbPerSecond( consume ), consume / loop );
+	if ( iterate < 0 ) {
+		std::printf( "   \"iterate\": null}%s\n", last ? "" : "," );
+	} else {
+		std::printf( "   \"iterate\": {\"ns_per_elem\": %.4f, \"gb_per_s\": %.3f, \"vs_loop\": %.3f}}%s\n",
+			nsPerElement( iterate ), gbPerSecond( iterate ), iterate / loop, last ? "" : "," );
+	}
+}
+
+} // namespace
+
+int main( int argc, char** argv ) {
+	Settings settings;
+	std::string only;
+	for ( int i = 1; i < argc; ++i ) {
+		if ( std::strcmp( argv[ i ], "--quick" ) == 0 ) {
+			settings.minSeconds = 0.0005;
+			settings.repetitions = 1;
+			settings.sizes = { 1 << 10 };
+		} else {
+			only = argv[ i ];
+		}
+	}
+
+	std::vector< Case > cases;
+	for ( size_t n : settings.sizes ) {
+		addTypedCases< std::int32_t >( cases, n );
+		addTypedCases< std::int64_t >( cases, n );
+		addTypedCases< float >( cases, n );
+		addTypedCases< double >( cases, n );
+		addGeneratedCases( cases, n );
+	}
+	if ( !only.empty() ) {
+		cases.erase( std::remove_if( cases.begin(), cases.end(), [&]( const Case& c ) {
+			return c.name.find( only ) == std::string::npos;
+		} ), cases.end() );
+	}
+
+	std::printf( "[\n" );
+	for ( size_t i = 0; i < cases.size(); ++i ) {
+		const Case& c = cases[ i ];
+		printResult( c, measure( c.loop, settings ), measure( c.consume, settings ),
+			c.iterate ? measure( c.iterate, settings ) : -1.0, i + 1 == cases.size() );
+		std::fflush( stdout );
+	}
+	std::printf( "]\n" );
+}
@@ -0,0 +1,183 @@
+// Canonical pipelines next to the loops they are meant to compile to. Each
+// pipeline_<name> has a loop_<name> twin, codegen_check compares the
+// machine code of the two, see codegen_check.cpp.
+#include "range.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+
+std::int64_t loop_range_map( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t i = 0; i < n; ++i ) {
+		total += i * 3 + 1;
+	}
+	return total;
+}
+
+std::int64_t pipeline_range_map( std::int64_t n ) {
+	std::int64_t total = 0;
+	forEach( range( n ) | uncachedMap( []( std::int64_t x ) { return x * 3 + 1; } ), [&]( std::int64_t x ) {
+		total += x;
+	} );
+	return total;
+}
+
+// The default map, which caches each result in its iterator.
+std::int64_t loop_range_map_cached( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t i = 0; i < n; ++i ) {
+		total += i * 3 + 1;
+	}
+	return total;
+}
+
+std::int64_t pipeline_range_map_cached( std::int64_t n ) {
+	std::int64_t total = 0;
+	forEach( range( n ) | map( []( std::int64_t x ) { return x * 3 + 1; } ), [&]( std::int64_t x ) {
+		total += x;
+	} );
+	return total;
+}
+
+std::int64_t loop_range_map_cached_iterators( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t i = 0; i < n; ++i ) {
+		total += i * 3 + 1;
+	}
+	return total;
+}
+
+std::int64_t pipeline_range_map_cached_iterators( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t x : range( n ) | map( []( std::int64_t x ) { return x * 3 + 1; } ) ) {
+		total += x;
+	}
+	return total;
+}
+
+std::int64_t loop_range_iterators( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t i = 0; i < n; ++i ) {
+		total += i * 3 + 1;
+	}
+	return total;
+}
+
+std::int64_t pipeline_range_iterators( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t x : range( n ) | uncachedMap( []( std::int64_t x ) { return x * 3 + 1; } ) ) {
+		total += x;
+	}
+	return total;
+}
+
+std::int64_t loop_range_step( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t i = 0; i < n; i += 2 ) {
+		total += i;
+	}
+	return total;
+}
+
+std::int64_t pipeline_range_step( std::int64_t n ) {
+	std::int64_t total = 0;
+	for ( std::int64_t x : range< 2 >( std::int64_t{ 0 }, n ) ) {
+		total += x;
+	}
+	return total;
+}
+
+std::int32_t loop_vector_map( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	for ( std::size_t i = 0; i < n; ++i ) {
+		total += data[ i ] * 5;
+	}
+	return total;
+}
+
+std::int32_t pipeline_vector_map( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	forEach( detail::Span< const std::int32_t >( data, n ) | map( []( std::int32_t x ) { return x * 5; } ),
+		[&]( std::int32_t x ) { total += x; } );
+	return total;
+}
+
+std::int32_t loop_vector_filter( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	for ( std::size_t i = 0; i < n; ++i ) {
+		if ( data[ i ] > 0 ) {
+			total += data[ i ];
+		}
+	}
+	return total;
+}
+
+std::int32_t pipeline_vector_filter( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	forEach( detail::Span< const std::int32_t >( data, n ) | filter( []( std::int32_t x ) { return x > 0; } ),
+		[&]( std::int32_t x ) { total += x; } );
+	return total;
+}
+
+std::int32_t loop_zip_dot( const std::int32_t* a, const std::int32_t* b, std::size_t n ) {
+	std::int32_t total = 0;
+	for ( std::size_t i = 0; i < n; ++i ) {
+		total += a[ i ] * b[ i ];
+	}
+	return total;
+}
+
+std::int32_t pipeline_zip_dot( const std::int32_t* a, const std::int32_t* b, std::size_t n ) {
+	std::int32_t total = 0;
+	forEach( zipWith( detail::Span< const std::int32_t >( a, n ), detail::Span< const std::int32_t >( b, n ), std::multiplies<>() ),
+		[&]( std::int32_t x ) { total += x; } );
+	return total;
+}
+
+std::int32_t loop_take( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	for ( std::size_t i = 0; i < n / 2; ++i ) {
+		total += data[ i ];
+	}
+	return total;
+}
+
+std::int32_t pipeline_take( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	forEach( detail::Span< const std::int32_t >( data, n ) | take( n / 2 ), [&]( std::int32_t x ) { total += x; } );
+	return total;
+}
+
+std::int32_t loop_sum( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	for ( std::size_t i = 0; i < n; ++i ) {
+		total += data[ i ];
+	}
+	return total;
+}
+
+std::int32_t pipeline_sum( const std::int32_t* data, std::size_t n ) {
+	return sum( detail::Span< const std::int32_t >( data, n ) );
+}
+
+// Without RANGE_INSTRUMENT an instrument is no stage at all.
+std::int32_t loop_instrument_disabled( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	for ( std::size_t i = 0; i < n; ++i ) {
+		if ( data[ i ] > 0 ) {
+			total += data[ i ];
+		}
+	}
+	return total;
+}
+
+std::int32_t pipeline_instrument_disabled( const std::int32_t* data, std::size_t n ) {
+	std::int32_t total = 0;
+	forEach( detail::Span< const std::int32_t >( data, n ) | instrument( "source" ) | filter( []( std::int32_t x ) { return x > 0; } )
+		| instrument( "positive" ), [&]( std::int32_t x ) { total += x; } );
+	return total;
+}
+
+} // extern "C"
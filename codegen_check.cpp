@@ -0,0 +1,142 @@
+// Checks that the pipelines in codegen.cpp compile to the same kind of
+// machine code as their hand-written twins:
+//
+//   range_codegen_check <objdump> <codegen object file>
+//
+// For every pipeline_<name> the disassembly must contain no calls, must
+// use vector registers if loop_<name> does, must not contain more loops
+// (backward jumps) and must stay within an instruction budget relative to
+// the loop. Prints one line per pair and fails if any pair regressed.
+#include <cstdio>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Signature {
+	int instructions = 0;
+	int calls = 0;
+	int vectorInstructions = 0;
+	int backwardJumps = 0;
+};
+
+// How much larger than its loop a pipeline may get. The reductions run
+// several accumulators on purpose and only have to vectorize as well.
+struct Budget {
+	double factor;
+	int slack;
+};
+
+const std::map< std::string, Budget > budgets = {
+	{ "sum", { 3.0, 0 } },
+};
+
+const Budget defaultBudget = { 1.25, 4 };
+
+std::map< std::string, Signature > disassemble( const std::string& objdump, const std::string& object ) {
+	std::map< std::string, Signature > functions;
+	std::string command = objdump + " -d --no-show-raw-insn '" + object + "'";
+	FILE* pipe = popen( command.c_str(), "r" );
+	if ( !pipe ) {
+		return functions;
+	}
+
+	std::regex symbol( R"(^[0-9a-f]+ <([A-Za-z_0-9]+)>:)" );
+	std::regex instruction( R"(^\s+([0-9a-f]+):\s+(\S+)\s*(.*)$)" );
+	std::regex jumpTarget( R"(^([0-9a-f]+) <)" );
+	std::regex vectorRegister( R"(%[xyz]mm[0-9])" );
+
+	Signature* current = nullptr;
+	char buffer[ 4096 ];
+	while ( fgets( buffer, sizeof( buffer ), pipe ) ) {
+		std::string line( buffer );
+		while ( !line.empty() && ( line.back() == '\n' || line.back() == '\r' ) ) {
+			line.pop_back();
+		}
+		std::smatch match;
+		if ( std::regex_search( line, match, symbol ) ) {
+			current = &functions[ match[ 1 ] ];
+		} else if ( current && std::regex_search( line, match, instruction ) ) {
+			unsigned long address = std::stoul( match[ 1 ], nullptr, 16 );
+			std::string mnemonic = match[ 2 ];
+			std::string operands = match[ 3 ];
+			++current->instructions;
+			if ( mnemonic.rfind( "call", 0 ) == 0 ) {
+				++current->calls;
+			}
+			if ( std::regex_search( operands, vectorRegister ) && mnemonic.find( "nop" ) == std::string::npos ) {
+				++current->vectorInstructions;
+			}
+			std::smatch target;
+			if ( mnemonic[ 0 ] == 'j' && std::regex_search( operands, target, jumpTarget )
+					&& std::stoul( target[ 1 ], nullptr, 16 ) <= address ) {
+				++current->backwardJumps;
+			}
+		}
+	}
+	pclose( pipe );
+	return functions;
+}
+
+} // namespace
+
+int main( int argc, char** argv ) {
+	if ( argc != 3 ) {
+		std::fprintf( stderr, "usage: %s <objdump> <object>\n", argv[ 0 ] );
+		return 2;
+	}
+
+	auto functions = disassemble( argv[ 1 ], argv[ 2 ] );
+	int pairs = 0;
+	int failures = 0;
+	for ( const auto& [name, pipeline] : functions ) {
+		if ( name.rfind( "pipeline_", 0 ) != 0 ) {
+			continue;
+		}
+		std::string base = name.substr( std::string( "pipeline_" ).size() );
+		auto loop = functions.find( "loop_" + base );
+		if ( loop == functions.end() ) {
+			std::printf( "FAIL %s: no loop_%s to compare with\n", base.c_str(), base.c_str() );
+			++failures;
+			continue;
+		}
+		++pairs;
+
+		const Signature& reference = loop->second;
+		auto found = budgets.find( base );
+		Budget budget = found == budgets.end() ? defaultBudget : found->second;
+		int allowed = static_cast< int >( reference.instructions * budget.factor ) + budget.slack;
+
+		std::vector< std::string > problems;
+		if ( pipeline.calls > reference.calls ) {
+			problems.push_back( "calls out of line" );
+		}
+		if ( reference.vectorInstructions > 0 && pipeline.vectorInstructions == 0 ) {
+			problems.push_back( "not vectorized" );
+		}
+		if ( found == budgets.end() && pipeline.backwardJumps > reference.backwardJumps ) {
+			problems.push_back( "more loops" );
+		}
+		if ( pipeline.instructions > allowed ) {
+			problems.push_back( "over budget" );
+		}
+
+		std::printf( "%s %-28s instructions %3d / %3d (max %3d), vector %2d / %2d, loops %d / %d, calls %d",
+			problems.empty() ? "ok  " : "FAIL", base.c_str(), pipeline.instructions, reference.instructions, allowed,
+			pipeline.vectorInstructions, reference.vectorInstructions, pipeline.backwardJumps, reference.backwardJumps,
+			pipeline.calls );
+		for ( const auto& problem : problems ) {
+			std::printf( ", %s", problem.c_str() );
+		}
+		std::printf( "\n" );
+		failures += problems.empty() ? 0 : 1;
+	}
+
+	if ( pairs == 0 ) {
+		std::printf( "FAIL no pipelines found in %s\n", argv[ 2 ] );
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
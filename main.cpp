@@ -1,2 +1,5 @@
 #define CATCH_CONFIG_MAIN
+// The bundled Catch sizes its signal stack with SIGSTKSZ, which is no
+// longer a constant expression on recent glibc.
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch.hpp"
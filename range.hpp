@@ -3,9 +3,48 @@
 #include <optional>
 #include <utility>
 #include <cstddef>
+#include <algorithm>
+#include <limits>
 
-#include <iostream>
 #include <functional>
+#include <map>
+#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <string>
+#include <cstdio>
+#include <chrono>
+#include <charconv>
+#include <ostream>
+#include <string_view>
+#include <system_error>
+#include <stdexcept>
+#include <cerrno>
+
+#if defined( __AVX__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined( RANGE_INSTRUMENT_TIMING ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <x86intrin.h>
+#endif
 		
 namespace detail {
 
@@ -13,103 +52,524 @@ namespace detail {
 // that is cheap to copy.
 struct View {};
 
+template < typename It >
+using IteratorCategory = typename std::iterator_traits< It >::iterator_category;
+
+// The strongest category supported by all of the given iterators, capped at
+// random access.
+template < typename... Its >
+using CommonCategory = std::common_type_t< std::random_access_iterator_tag, IteratorCategory< Its >... >;
+
+template < typename It >
+constexpr bool isRandomAccess = std::is_base_of_v< std::random_access_iterator_tag, IteratorCategory< It > >;
+
+// Derives the remaining random access operators from operator+=, operator<
+// and operator- (distance) of the Derived iterator.
+template < typename Derived >
+struct RandomAccessOperators {
+	friend constexpr Derived& operator-=(Derived& it, std::ptrdiff_t n) { return it += -n; }
+	friend constexpr Derived operator+(Derived it, std::ptrdiff_t n) { return it += n; }
+	friend constexpr Derived operator+(std::ptrdiff_t n, Derived it) { return it += n; }
+	friend constexpr Derived operator-(Derived it, std::ptrdiff_t n) { return it += -n; }
+	friend constexpr bool operator>(const Derived& a, const Derived& b) { return b < a; }
+	friend constexpr bool operator<=(const Derived& a, const Derived& b) { return !(b < a); }
+	friend constexpr bool operator>=(const Derived& a, const Derived& b) { return !(a < b); }
+};
+
+// Map and zipWith keep the functor result for the current element so that
+// dereferencing twice calls the functor once. The uncached variant is an
+// empty base, its iterators compute on every dereference.
+template < typename T, bool Cached >
+struct ResultCache {
+	void resetValue() const { _value.reset(); }
+
+	mutable std::optional< T > _value;
+};
+
+template < typename T >
+struct ResultCache< T, false > {
+	constexpr void resetValue() const {}
+};
+
+// map and zipWith cache results unless this is specialized to false for
+// the functor type, which suits cheap functors such as x + 1.
+template < typename F >
+struct CacheResults : std::true_type {};
+
+// operator-> of iterators that return their elements by value.
+template < typename T >
+struct ArrowProxy {
+	constexpr const T* operator->() const { return &value; }
+
+	T value;
+};
+
+template < typename It >
+constexpr auto arrow( const It& it ) {
+	if constexpr ( std::is_pointer_v< It > ) {
+		return it;
+	} else {
+		return it.operator->();
+	}
+}
+
+// Sized views know their length without iterating and report it through
+// a size() member, so that consumers can preallocate.
+template < typename V, typename = void >
+struct IsSized : std::false_type {};
+
+template < typename V >
+struct IsSized< V, std::void_t< decltype( std::declval< const V& >().size() ) > > : std::true_type {};
+
+template < typename V >
+constexpr bool isSized = IsSized< V >::value;
+
+// Infinite views announce themselves with a static constexpr member
+// infinite = true. They are never sized, but they do not limit the size
+// of a zip either.
+template < typename V, typename = void >
+struct IsInfinite : std::false_type {};
+
+template < typename V >
+struct IsInfinite< V, std::void_t< decltype( V::infinite ) > > : std::bool_constant< V::infinite > {};
+
+template < typename V >
+constexpr bool isInfinite = IsInfinite< V >::value;
+
+// Views that allocate buffers of their own while iterating announce it
+// with a static constexpr member allocates = true, adaptors pass it on
+// from their sources.
+template < typename V, typename = void >
+struct IsAllocating : std::false_type {};
+
+template < typename V >
+struct IsAllocating< V, std::void_t< decltype( V::allocates ) > > : std::bool_constant< V::allocates > {};
+
+template < typename V >
+constexpr bool isAllocating = IsAllocating< V >::value;
+
+template < typename V, typename = std::enable_if_t< isSized< V > > >
+constexpr size_t size( const V& v ) {
+	return static_cast< size_t >( v.size() );
+}
+
+template < typename V >
+using SentinelOf = decltype( std::declval< const V& >().end() );
+
+// Common views end in an iterator of the same type as begin(), the others
+// end in a sentinel that iterators only compare against.
+template < typename V >
+constexpr bool isCommon = std::is_same_v< typename V::iterator, SentinelOf< V > >;
+
+// Distance from begin to end of a random access view that is common or
+// infinite, an infinite view is longer than anything it is combined with.
+// Sized views answer without touching their iterators, which keeps nested
+// zips from recomputing the ends of both sides at every level.
+template < typename V >
+constexpr std::ptrdiff_t boundedDistance( const V& v ) {
+	if constexpr ( isInfinite< V > ) {
+		return std::numeric_limits< std::ptrdiff_t >::max();
+	} else if constexpr ( isSized< V > ) {
+		return static_cast< std::ptrdiff_t >( v.size() );
+	} else {
+		return v.end() - v.begin();
+	}
+}
+
+// Remembers a position that is expensive to find, such as the first
+// element of a Filter. Copies start out empty because the position may
+// point into the view it was computed for. Filling it is not
+// synchronized, so a view that holds one must not be iterated from
+// several threads at once, give each thread a copy instead.
+template < typename It >
+struct CachedPosition {
+	CachedPosition() = default;
+	constexpr CachedPosition( const CachedPosition& ) {}
+
+	constexpr CachedPosition& operator=( const CachedPosition& ) {
+		_it.reset();
+		return *this;
+	}
+
+	template < typename Compute >
+	const It& get( Compute compute ) const {
+		if ( !_it ) {
+			_it = compute();
+		}
+		return *_it;
+	}
+
+private:
+	mutable std::optional< It > _it;
+};
+
+// End of an infinite view, no iterator ever reaches it.
+struct Unreachable {
+	template < typename It >
+	friend constexpr bool operator==( const It&, Unreachable ) { return false; }
+
+	template < typename It >
+	friend constexpr bool operator!=( const It&, Unreachable ) { return true; }
+};
+
+// Hands one element to a sink. Sinks either return nothing or a bool that
+// is false once they do not want any more elements.
+template < typename Sink, typename T >
+constexpr bool push( Sink& sink, T&& x ) {
+	if constexpr ( std::is_void_v< std::invoke_result_t< Sink&, T&& > > ) {
+		sink( std::forward< T >( x ) );
+		return true;
+	} else {
+		return static_cast< bool >( sink( std::forward< T >( x ) ) );
+	}
+}
+
+struct AnySink {
+	template < typename T >
+	constexpr bool operator()( T&& ) const { return true; }
+};
+
+// Pushes n elements starting at p, the loop of every contiguous view.
+template < typename T, typename Sink >
+constexpr bool consumeArray( const T* p, size_t n, Sink& sink ) {
+	for ( const T* end = p + n; p != end; ++p ) {
+		if ( !push( sink, *p ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template < typename V, typename = void >
+struct HasConsume : std::false_type {};
+
+template < typename V >
+struct HasConsume< V, std::void_t< decltype( std::declval< const V& >().consume( std::declval< AnySink& >() ) ) > >
+	: std::true_type {};
+
+// Internal iteration: pushes every element of the view into the sink in a
+// single loop instead of stepping through the nested iterators. Returns
+// false if the sink stopped early.
+template < typename V, typename Sink >
+constexpr bool consume( const V& v, Sink&& sink ) {
+	if constexpr ( HasConsume< V >::value ) {
+		return v.consume( sink );
+	} else {
+		for ( auto it = v.begin(); it != v.end(); ++it ) {
+			if ( !push( sink, *it ) ) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+// Views and containers whose elements sit in one array, reachable
+// through data() as pointers to their value_type. std::vector< bool >
+// is not one of them.
+template < typename T, typename = void >
+struct HasData : std::false_type {};
+
 template < typename T >
-struct ContainerView : public View {
+struct HasData< T, std::void_t< decltype( std::declval< const T& >().data() ) > >
+	: std::is_same< decltype( std::declval< const T& >().data() ), const typename T::value_type* > {};
+
+// Container access shared by ContainerView and OwningView, Derived
+// provides container().
+template < typename Derived, typename T >
+struct ContainerViewBase : public View {
     using value_type = typename T::value_type;
     using const_iterator = typename T::const_iterator;
     using difference_type = typename T::difference_type;
     using iterator = typename T::const_iterator;
 
-    explicit ContainerView( const T& t ) : _t( t ) {}
+    constexpr iterator begin() const { return container().begin(); }
+    constexpr iterator end() const { return container().end(); }
+
+    template < typename U = T, typename = decltype( std::declval< const U& >().size() ) >
+    constexpr size_t size() const { return container().size(); }
+
+    // Containers with contiguous storage, such as std::vector and
+    // std::string, expose it so that adaptors and terminals can loop over
+    // plain pointers.
+    template < typename U = T, typename = std::enable_if_t< HasData< U >::value > >
+    constexpr const value_type* data() const { return container().data(); }
+
+    template < typename Sink >
+    constexpr bool consume( Sink&& sink ) const {
+        if constexpr ( HasData< T >::value ) {
+            return consumeArray( data(), size(), sink );
+        } else {
+            for ( const auto& x : container() ) {
+                if ( !push( sink, x ) ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+private:
+    constexpr const T& container() const { return static_cast< const Derived& >( *this ).container(); }
+};
+
+template < typename T >
+struct ContainerView : public ContainerViewBase< ContainerView< T >, T > {
+    constexpr explicit ContainerView( const T& t ) : _t( t ) {}
 
-    auto begin() const { return _t.begin(); }
-    auto end() const { return _t.end(); }
+    constexpr const T& container() const { return _t; }
 
 private:
 	// reference to container
     const T& _t;
 };
 
+// Takes over a container passed as an rvalue, so that pipelines built on
+// temporaries neither dangle nor copy. Move-only, a copy of the view would
+// be a copy of the whole container.
+template < typename T >
+struct OwningView : public ContainerViewBase< OwningView< T >, T > {
+    constexpr explicit OwningView( T&& t ) : _t( std::move( t ) ) {}
+
+    OwningView( OwningView&& ) = default;
+    OwningView& operator=( OwningView&& ) = default;
+
+    constexpr const T& container() const { return _t; }
+
+private:
+    T _t;
+};
+
+// Refers to a view that cannot be copied, such as a named pipeline that
+// owns its container. The view must outlive the reference, as a container
+// must outlive its ContainerView.
+template < typename V >
+struct RefView : public View {
+    using value_type = typename V::value_type;
+    using difference_type = typename V::difference_type;
+    using iterator = typename V::iterator;
+    using const_iterator = typename V::iterator;
+
+    static constexpr bool infinite = isInfinite< V >;
+    static constexpr bool allocates = isAllocating< V >;
+
+    constexpr explicit RefView( const V& v ) : _v( &v ) {}
+
+    constexpr iterator begin() const { return _v->begin(); }
+    constexpr SentinelOf< V > end() const { return _v->end(); }
+
+    template < typename U = V, typename = std::enable_if_t< isSized< U > > >
+    constexpr size_t size() const { return detail::size( *_v ); }
+
+    template < typename U = V, typename = std::enable_if_t< HasData< U >::value > >
+    constexpr const value_type* data() const { return _v->data(); }
+
+    template < typename Sink >
+    constexpr bool consume( Sink&& sink ) const {
+        return detail::consume( *_v, sink );
+    }
+
+    template < typename Op, typename U = V >
+    constexpr auto reduce( Op op ) const -> decltype( std::declval< const U& >().reduce( op ) ) {
+        return _v->reduce( op );
+    }
+
+private:
+    const V* _v;
+};
+
+// Contiguous views expose data() and size(), their elements are
+// data()[ 0 ] .. data()[ size() - 1 ].
+template < typename V >
+constexpr bool isContiguous() {
+	return HasData< V >::value && isSized< V >;
+}
+
+// A pointer and a length, the blocks that chunk and mapBatched hand out.
+template < typename T >
+struct Span {
+	using value_type = std::remove_cv_t< T >;
+	using iterator = T*;
+	using const_iterator = T*;
+	using difference_type = std::ptrdiff_t;
+
+	Span() = default;
+	constexpr Span(T* data, size_t size) : _data(data), _size(size) { }
+
+	constexpr T* data() const { return _data; }
+	constexpr size_t size() const { return _size; }
+	constexpr bool empty() const { return _size == 0; }
+
+	constexpr T* begin() const { return _data; }
+	constexpr T* end() const { return _data + _size; }
+
+	constexpr T& operator[](size_t i) const { return _data[i]; }
+
+private:
+	T* _data = nullptr;
+	size_t _size = 0;
+};
+
 template < typename RangeConstructor >
 // RangeConstructor f - is just a function that takes auto input and returns something like map(input, functor)
 struct RangeBuilder { RangeConstructor f; };
 
 template < typename RangeConstructor >
-auto makeRangeBuilder( RangeConstructor c ) {
+constexpr auto makeRangeBuilder( RangeConstructor c ) {
     return RangeBuilder< RangeConstructor >{ c };
 }
 
-template < typename As, typename F >
+template < typename As, typename F, bool Cached = true >
 struct Map : public View {
 
 	using value_type = typename std::result_of_t< F( typename As::value_type ) >;
 	using difference_type = typename As::difference_type;
+	using Source = As;
+	using Functor = F;
+	static constexpr bool cached = Cached;
 
-	explicit Map(As inputView, F functor) : _inputView(std::move(inputView)), _functor(std::move(functor)) { }
+	constexpr explicit Map(As inputView, F functor) : _inputView(std::move(inputView)), _functor(std::move(functor)) { }
 
-	struct Iterator {
+	// The parts of the view, taken apart when it fuses with the next stage.
+	constexpr const As& source() const& { return _inputView; }
+	constexpr As source() && { return std::move(_inputView); }
+	constexpr const F& functor() const& { return _functor; }
+	constexpr F functor() && { return std::move(_functor); }
+
+	// Only used when the source itself ends in a sentinel.
+	struct Sentinel {
+		SentinelOf< As > end;
+	};
+
+	struct Iterator : RandomAccessOperators< Iterator >, ResultCache< value_type, Cached > {
 		using value_type = typename std::result_of_t< F( typename As::value_type ) >;
-		using iterator_category = std::forward_iterator_tag;
+		using iterator_category = CommonCategory< typename As::iterator >;
 		using difference_type = ptrdiff_t;
-		using pointer = const value_type*;
-		using reference = const value_type&;
+		using pointer = std::conditional_t< Cached, const value_type*, ArrowProxy< value_type > >;
+		using reference = std::conditional_t< Cached, const value_type&, value_type >;
 
 		// ForwardIterator must be DefaultConstructible
 		Iterator() = default;
 
-		Iterator(typename As::iterator it, const F* functor) :  _it(std::move(it)), _functor(functor) { }
+		constexpr Iterator(typename As::iterator it, const F* functor) :  _it(std::move(it)), _functor(functor) { }
 
-		bool operator==(const Map::Iterator& other) const {
-			return _it == other._it && _functor == other._functor;
+		constexpr bool operator==(const Map::Iterator& other) const {
+			return _it == other._it;
 		}	
 
-		bool operator!=(const Map::Iterator& other) const {
+		constexpr bool operator!=(const Map::Iterator& other) const {
 			return !(*this == other);
 		}
 
-		reference operator*() {
-			if (!_value) {
-				_value = (*_functor)(*_it);
+		constexpr bool operator==(const Sentinel& s) const {
+			return _it == s.end;
+		}
+
+		constexpr bool operator!=(const Sentinel& s) const {
+			return !(*this == s);
+		}
+
+		constexpr reference operator*() const {
+			if constexpr (Cached) {
+				if (!this->_value) {
+					this->_value = (*_functor)(*_it);
+				}
+				return *this->_value;
+			} else {
+				return (*_functor)(*_it);
 			}
-			return *_value;
 		}
 
-		Iterator& operator++() {
+		constexpr Iterator& operator++() {
 			++_it;
-			_value.reset();
+			this->resetValue();
 			return *this;
 		}
 
-		Iterator operator++(int) {
+		constexpr Iterator operator++(int) {
 			Iterator tmp(*this); // copy
 			++*this;
 			return tmp;
 		}
 
-		pointer operator->() {
-			return &(*(*this));
+		constexpr Iterator& operator--() {
+			--_it;
+			this->resetValue();
+			return *this;
+		}
+
+		constexpr Iterator operator--(int) {
+			Iterator tmp(*this); // copy
+			--*this;
+			return tmp;
+		}
+
+		constexpr Iterator& operator+=(difference_type n) {
+			_it += n;
+			this->resetValue();
+			return *this;
+		}
+
+		friend constexpr difference_type operator-(const Map::Iterator& a, const Map::Iterator& b) {
+			return a._it - b._it;
+		}
+
+		constexpr bool operator<(const Map::Iterator& other) const {
+			return _it < other._it;
+		}
+
+		// Computed on the fly, the cache only ever holds the current element.
+		constexpr value_type operator[](difference_type n) const {
+			return (*_functor)(_it[n]);
+		}
+
+		constexpr pointer operator->() const {
+			if constexpr (Cached) {
+				return &(*(*this));
+			} else {
+				return pointer{ *(*this) };
+			}
 		}
 
 	private:
 		typename As::iterator _it;
 		const F* _functor;
-		std::optional<value_type> _value;
 	};
 
 	using iterator = Iterator;
 	using const_iterator = Iterator;
+	using sentinel = std::conditional_t< isCommon< As >, Iterator, Sentinel >;
 
-	iterator begin() const {
+	constexpr iterator begin() const {
 		return Iterator(_inputView.begin(), &_functor);
 	}
 
-	iterator end() const {
-		return Iterator(_inputView.end(), &_functor);
+	constexpr sentinel end() const {
+		if constexpr (isCommon< As >) {
+			return Iterator(_inputView.end(), &_functor);
+		} else {
+			return Sentinel{ _inputView.end() };
+		}
+	}
+
+	static constexpr bool infinite = isInfinite< As >;
+	static constexpr bool allocates = isAllocating< As >;
+
+	template < typename V = As, typename = std::enable_if_t< isSized< V > > >
+	constexpr size_t size() const {
+		return detail::size(_inputView);
+	}
+
+	template < typename Sink >
+	constexpr bool consume(Sink&& sink) const {
+		return detail::consume(_inputView, [&](auto&& x) {
+			return push(sink, _functor(std::forward< decltype(x) >(x)));
+		});
 	}
 
 private:
-	const As _inputView;
-	const F _functor;
+	As _inputView;
+	F _functor;
 };
 
 template < typename As, typename F >
@@ -117,176 +577,415 @@ struct Filter : public View {
 
 	using value_type = typename As::value_type;
 	using difference_type = typename As::difference_type;
+	using Source = As;
+	using Predicate = F;
+
+	constexpr explicit Filter(As inputView, F functor) : _inputView(std::move(inputView)), _functor(std::move(functor)) { }
 
-	explicit Filter(As inputView, F functor) : _inputView(std::move(inputView)), _functor(std::move(functor)) { }
+	// The parts of the view, taken apart when it fuses with the next stage.
+	constexpr const As& source() const& { return _inputView; }
+	constexpr As source() && { return std::move(_inputView); }
+	constexpr const F& predicate() const& { return _functor; }
+	constexpr F predicate() && { return std::move(_functor); }
 
+	// Only used when the source itself ends in a sentinel.
+	struct Sentinel {
+		SentinelOf< As > end;
+	};
+
+	// The iterator looks up the predicate and the source end through the
+	// view instead of carrying its own copy of the end.
 	struct Iterator {
 		using value_type = typename As::value_type;
-		using iterator_category = std::forward_iterator_tag;
+		using iterator_category = std::common_type_t< std::forward_iterator_tag, IteratorCategory< typename As::iterator > >;
 		using difference_type = ptrdiff_t;
-		using pointer = const value_type*;
-		using reference = const value_type&;
+		using pointer = typename std::iterator_traits< typename As::iterator >::pointer;
+		using reference = typename std::iterator_traits< typename As::iterator >::reference;
 
 		// ForwardIterator must be DefaultConstructible
 		Iterator() = default;
 
-		Iterator(const F* functor, typename As::iterator it, typename As::iterator end)
-				: _functor(functor), _it(std::move(it)), _end(std::move(end)) { }
+		constexpr Iterator(const Filter* parent, typename As::iterator it)
+				: _parent(parent), _it(std::move(it)) { }
 
-		bool operator==(const Filter::Iterator& other) const {
-			return _it == other._it && _functor == other._functor;
+		constexpr bool operator==(const Filter::Iterator& other) const {
+			return _it == other._it;
 		}	
 
-		bool operator!=(const Filter::Iterator& other) const {
+		constexpr bool operator!=(const Filter::Iterator& other) const {
 			return !(*this == other);
 		}
 
-		reference operator*() {
+		constexpr bool operator==(const Sentinel& s) const {
+			return _it == s.end;
+		}
+
+		constexpr bool operator!=(const Sentinel& s) const {
+			return !(*this == s);
+		}
+
+		constexpr reference operator*() const {
 			return *_it;
 		}
 
-		Iterator& operator++() {
+		constexpr Iterator& operator++() {
+			auto end = _parent->_inputView.end();
 			do {
 				++_it;
-			} while (_it != _end &&
-					 !(*_functor)(*_it));
+			} while (_it != end &&
+					 !(_parent->_functor)(*_it));
 
 			return *this;
 		}
 
-		Iterator operator++(int) {
+		constexpr Iterator operator++(int) {
 			Iterator tmp(*this); // copy
 			++*this;
 			return tmp;
 		}
 
-		pointer operator->() {
-			return &(*(*this));
+		constexpr pointer operator->() const {
+			return arrow(_it);
 		}
 
 	private:
-		const F* _functor;
+		const Filter* _parent;
 		typename As::iterator _it;
-		typename As::iterator _end;
 	};
 
 	using iterator = Iterator;
 	using const_iterator = Iterator;
+	using sentinel = std::conditional_t< isCommon< As >, Iterator, Sentinel >;
+
+	// The scan for the first match runs once per view, not once per call.
+	// It fills a cache even though begin() is const, so a Filter is not
+	// safe to begin() from several threads at once.
+	constexpr iterator begin() const {
+		return Iterator(this, _begin.get([this] {
+			auto it = _inputView.begin();
+			auto end = _inputView.end();
+			while(it != end && !(_functor)(*it)) {
+				++it;
+			}
+			return it;
+		}));
+	}
 
-	iterator begin() const {
-		auto it = _inputView.begin();
-		while(it != _inputView.end() && !(_functor)(*it)) {
-			++it;
+	constexpr sentinel end() const {
+		if constexpr (isCommon< As >) {
+			return Iterator(this, _inputView.end());
+		} else {
+			return Sentinel{ _inputView.end() };
 		}
-		return Iterator(&_functor, it, _inputView.end());
 	}
 
-	iterator end() const {
-		return Iterator(&_functor, _inputView.end(), _inputView.end());
+	static constexpr bool infinite = isInfinite< As >;
+	static constexpr bool allocates = isAllocating< As >;
+
+	template < typename Sink >
+	constexpr bool consume(Sink&& sink) const {
+		return detail::consume(_inputView, [&](auto&& x) {
+			return !_functor(x) || push(sink, std::forward< decltype(x) >(x));
+		});
 	}
 
 private:
-	const As _inputView;
-	const F _functor;
+	As _inputView;
+	F _functor;
+	CachedPosition< typename As::iterator > _begin;
 };
 
-template < typename As, typename Bs, typename F >
+template < typename As, typename Bs, typename F, bool Cached = true >
 struct ZipWith : public View {
 	using value_type = typename std::result_of_t< F( typename As::value_type, typename Bs::value_type ) >;
 	using difference_type = typename As::difference_type;
 
-	explicit ZipWith(As iA, Bs iB, F functor) : _iA(std::move(iA)), _iB(std::move(iB)), _functor(std::move(functor)) { }
+	constexpr explicit ZipWith(As iA, Bs iB, F functor) : _iA(std::move(iA)), _iB(std::move(iB)), _functor(std::move(functor)) { }
 
-	struct Iterator {
+	static constexpr bool randomAccess = isRandomAccess< typename As::iterator > && isRandomAccess< typename Bs::iterator >;
+	static constexpr bool infinite = isInfinite< As > && isInfinite< Bs >;
+	static constexpr bool allocates = isAllocating< As > || isAllocating< Bs >;
+
+	// When both sides can jump, the end is the position where the shorter
+	// side runs out, reached by both iterators in lockstep. Otherwise the
+	// end is a sentinel that holds both source ends.
+	static constexpr bool common = randomAccess && !infinite
+		&& ( isCommon< As > || isInfinite< As > ) && ( isCommon< Bs > || isInfinite< Bs > );
+
+	struct Sentinel {
+		SentinelOf< As > endA;
+		SentinelOf< Bs > endB;
+	};
+
+	struct Iterator : RandomAccessOperators< Iterator >, ResultCache< value_type, Cached > {
 		using value_type = typename std::result_of_t< F( typename As::value_type, typename Bs::value_type ) >;
-		using iterator_category = std::forward_iterator_tag;
+		using iterator_category = CommonCategory< typename As::iterator, typename Bs::iterator >;
 		using difference_type = ptrdiff_t;
-		using pointer = const value_type*;
-		using reference = const value_type&;
+		using pointer = std::conditional_t< Cached, const value_type*, ArrowProxy< value_type > >;
+		using reference = std::conditional_t< Cached, const value_type&, value_type >;
 
 		// ForwardIterator must be DefaultConstructible
 		Iterator() = default;
 
-		Iterator(typename As::iterator itA, typename Bs::iterator itB, const F* functor, typename As::iterator endA, typename Bs::iterator endB)
-			: _itA(std::move(itA)), _itB(std::move(itB)), _functor(functor), _endA(std::move(endA)), _endB(std::move(endB)) { }
+		constexpr Iterator(typename As::iterator itA, typename Bs::iterator itB, const F* functor)
+			: _itA(std::move(itA)), _itB(std::move(itB)), _functor(functor) { }
 
-		bool operator==(const ZipWith::Iterator& other) const {
-			return _itA == other._itA && _itB == other._itB && _functor == other._functor;
+		// Both sides always move together, so one of them tells the position.
+		// A finite side is preferred, the position of an infinite side may be
+		// all its values tell.
+		constexpr bool operator==(const ZipWith::Iterator& other) const {
+			if constexpr (isInfinite< As > && !isInfinite< Bs >) {
+				return _itB == other._itB;
+			} else {
+				return _itA == other._itA;
+			}
 		}
 
-		bool operator!=(const ZipWith::Iterator& other) const {
+		constexpr bool operator!=(const ZipWith::Iterator& other) const {
 			return !(*this == other);
 		}
 
-		reference operator*() { 
-			if(!_value) {
-				_value = (*_functor)(*_itA, *_itB);
+		constexpr bool operator==(const Sentinel& s) const {
+			return _itA == s.endA || _itB == s.endB;
+		}
+
+		constexpr bool operator!=(const Sentinel& s) const {
+			return !(*this == s);
+		}
+
+		constexpr reference operator*() const {
+			if constexpr (Cached) {
+				if (!this->_value) {
+					this->_value = (*_functor)(*_itA, *_itB);
+				}
+				return *this->_value;
+			} else {
+				return (*_functor)(*_itA, *_itB);
 			}
-			return *_value;
 		}
 
-		Iterator& operator++() {
+		constexpr Iterator& operator++() {
 			++_itA;
 			++_itB;
+			this->resetValue();
+			return *this;
+		}
 
-			if (_itA == _endA || _itB == _endB) {
-				_itA = _endA;
-				_itB = _endB;
-			}
+		constexpr Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
 
-			_value.reset();
+		constexpr Iterator& operator--() {
+			--_itA;
+			--_itB;
+			this->resetValue();
 			return *this;
 		}
 
-		Iterator operator++(int) {
+		constexpr Iterator operator--(int) {
 			Iterator tmp(*this); // copy
-			++*this;
+			--*this;
 			return tmp;
 		}
-		
-		pointer operator->() {
-			return &(*(*this));
+
+		constexpr Iterator& operator+=(difference_type n) {
+			_itA += n;
+			_itB += n;
+			this->resetValue();
+			return *this;
+		}
+
+		friend constexpr difference_type operator-(const ZipWith::Iterator& a, const ZipWith::Iterator& b) {
+			if constexpr (isInfinite< As > && !isInfinite< Bs >) {
+				return a._itB - b._itB;
+			} else {
+				return a._itA - b._itA;
+			}
+		}
+
+		constexpr bool operator<(const ZipWith::Iterator& other) const {
+			if constexpr (isInfinite< As > && !isInfinite< Bs >) {
+				return _itB < other._itB;
+			} else {
+				return _itA < other._itA;
+			}
+		}
+
+		constexpr value_type operator[](difference_type n) const {
+			return (*_functor)(_itA[n], _itB[n]);
+		}
+
+		constexpr pointer operator->() const {
+			if constexpr (Cached) {
+				return &(*(*this));
+			} else {
+				return pointer{ *(*this) };
+			}
 		}
 
 	private:
 		typename As::iterator _itA;
 		typename Bs::iterator _itB;
 		const F* _functor;
-		typename As::iterator _endA;
-		typename Bs::iterator _endB;
-		std::optional<value_type> _value;
 	};
 
 	using iterator = Iterator;
 	using const_iterator = Iterator;
+	using sentinel = std::conditional_t< common, Iterator, Sentinel >;
 
-	iterator begin() const {
-		if (_iA.begin() == _iA.end() || _iB.begin() == _iB.end()) {
-			return Iterator(_iA.end(), _iB.end(), &_functor, _iA.end(), _iB.end());
+	constexpr iterator begin() const {
+		return Iterator(_iA.begin(), _iB.begin(), &_functor);
+	}
+
+	constexpr sentinel end() const {
+		if constexpr (common) {
+			auto n = std::min(boundedDistance(_iA), boundedDistance(_iB));
+			return Iterator(_iA.begin() + n, _iB.begin() + n, &_functor);
+		} else {
+			return Sentinel{ _iA.end(), _iB.end() };
+		}
+	}
+
+	// The shorter side decides, an infinite side never does.
+	template < typename A = As, typename B = Bs,
+		typename = std::enable_if_t< ( isSized< A > || isInfinite< A > ) && ( isSized< B > || isInfinite< B > ) && !infinite > >
+	constexpr size_t size() const {
+		if constexpr (isInfinite< A >) {
+			return detail::size(_iB);
+		} else if constexpr (isInfinite< B >) {
+			return detail::size(_iA);
+		} else {
+			return std::min(detail::size(_iA), detail::size(_iB));
 		}
-		return Iterator(_iA.begin(), _iB.begin(), &_functor, _iA.end(), _iB.end());
 	}
 
-	iterator end() const {
-		return Iterator(_iA.end(), _iB.end(), &_functor, _iA.end(), _iB.end());
+	// Two contiguous sides run on a pair of pointers bounded by the
+	// shorter side. Otherwise side A drives the loop and side B is stepped
+	// along by its iterator.
+	template < typename Sink >
+	constexpr bool consume(Sink&& sink) const {
+		if constexpr (isContiguous< As >() && isContiguous< Bs >()) {
+			const auto* a = _iA.data();
+			const auto* b = _iB.data();
+			for (const auto* end = a + size(); a != end; ++a, ++b) {
+				if (!push(sink, _functor(*a, *b))) {
+					return false;
+				}
+			}
+			return true;
+		}
+		auto itB = _iB.begin();
+		auto endB = _iB.end();
+		bool stopped = false;
+		detail::consume(_iA, [&](auto&& a) {
+			if (itB == endB) {
+				return false;
+			}
+			if (!push(sink, _functor(std::forward< decltype(a) >(a), *itB))) {
+				stopped = true;
+				return false;
+			}
+			++itB;
+			return true;
+		});
+		return !stopped;
 	}
 
 private:
-	const As _iA;
-	const Bs _iB;
-	const F _functor;
+	As _iA;
+	Bs _iB;
+	F _functor;
+};
+
+// Step of a Range that is only known at run time.
+template < typename Integer >
+struct DynamicStep {
+	DynamicStep() = default;
+	constexpr explicit DynamicStep(Integer step) : _step(step) { }
+
+	constexpr Integer step() const { return _step; }
+
+private:
+	Integer _step;
+};
+
+// Step of a Range fixed at compile time. It takes no space and lets the
+// compiler drop every check on the sign of the step.
+template < typename Integer, Integer Step >
+struct StaticStep {
+	static_assert(Step != 0, "range step must not be zero");
+
+	StaticStep() = default;
+	constexpr explicit StaticStep(Integer) { }
+
+	static constexpr Integer step() { return Step; }
+};
+
+// from + n * step. Integers are stepped in their unsigned counterpart,
+// which wraps instead of overflowing. Positions past the last element,
+// such as the end iterator, may wrap around but are never dereferenced.
+template < typename Integer, typename N >
+constexpr Integer advanceValue(Integer from, N n, Integer step) {
+	if constexpr (std::is_integral_v< Integer >) {
+		using Unsigned = std::make_unsigned_t< Integer >;
+		return static_cast< Integer >(static_cast< Unsigned >(
+			static_cast< Unsigned >(from) + static_cast< Unsigned >(n) * static_cast< Unsigned >(step)));
+	} else {
+		return from + static_cast< Integer >(n) * step;
+	}
+}
+
+// Where a Range iterator finds the value n positions on. Integers step from
+// the current value, which wraps to exactly from + i * step. Floating point
+// values would collect rounding errors that way, so they are recomputed
+// from the first value and the position.
+template < typename Integer, bool Exact = std::is_integral_v< Integer > >
+struct RangeOrigin {
+	RangeOrigin() = default;
+	constexpr explicit RangeOrigin(Integer) { }
+
+	constexpr Integer advance(Integer value, size_t, ptrdiff_t n, Integer step) const {
+		return advanceValue(value, n, step);
+	}
 };
 
 template < typename Integer >
+struct RangeOrigin< Integer, false > {
+	RangeOrigin() = default;
+	constexpr explicit RangeOrigin(Integer from) : _from(from) { }
+
+	constexpr Integer advance(Integer, size_t index, ptrdiff_t n, Integer step) const {
+		return advanceValue(_from, index + static_cast< size_t >(n), step);
+	}
+
+private:
+	Integer _from;
+};
+
+// The number of elements is computed once on construction. Iterators then
+// count positions, so that iteration is exact right up to the limits of
+// Integer, and carry the current value along for dereferencing. Floating
+// point ranges hold the from + i * step that lie before to.
+template < typename Integer, typename Step = DynamicStep< Integer > >
 struct Range : public View {
+	static_assert(std::is_arithmetic_v< Integer >, "range needs a numeric type");
+
 	using value_type = Integer;
 	using difference_type = std::ptrdiff_t;
 
-	explicit Range(Integer from, Integer to, Integer step) : _from(std::move(from)), _to(std::move(to)), _step(std::move(step)) { }
+	constexpr explicit Range(Integer from, Integer to, Integer step)
+		: _from(from), _count(count(from, to, step)), _step(step) { }
 
-	struct Iterator {
+	// The first n elements of from, from + step, ...
+	struct Counted {};
+	constexpr explicit Range(Integer from, size_t n, Integer step, Counted)
+		: _from(from), _count(n), _step(step) { }
+
+	struct Iterator : RandomAccessOperators< Iterator >, Step, RangeOrigin< Integer > {
 		using value_type = Integer;
-		using iterator_category = std::forward_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
 		using difference_type = ptrdiff_t;
 		using pointer = const value_type*;
 		using reference = const value_type&;
@@ -294,107 +993,3165 @@ struct Range : public View {
 		// ForwardIterator must be DefaultConstructible
 		Iterator() = default;
 
-		Iterator(Integer from, Integer to, Integer step) : _from(std::move(from)), _to(std::move(to)), _step(std::move(step)) { }
+		constexpr Iterator(Integer from, size_t index, Step step)
+			: Step(step), RangeOrigin< Integer >(from), _value(advanceValue(from, index, step.step())), _index(index) { }
 
-		bool operator==(const Range::Iterator& other) const {
-			return _from == other._from && _to == other._to && _step == other._step;
+		constexpr bool operator==(const Range::Iterator& other) const {
+			return _index == other._index;
 		}	
 
-		bool operator!=(const Range::Iterator& other) const {
+		constexpr bool operator!=(const Range::Iterator& other) const {
 			return !(*this == other);
 		}
 
-		reference operator*() {
-			return _from;
+		constexpr reference operator*() const {
+			return _value;
 		}
 
-		Iterator& operator++() {
-			if (_step > 0) {
-				if (_to - _step > _from) {
-					_from += _step;
-				} else {
-					_from = _to;
-				}
-			} else {
-				if (_to - _step < _from) {
-					_from += _step;
-				} else {
-					_from = _to;
-				}
-			}
-
+		constexpr Iterator& operator++() {
+			_value = this->advance(_value, _index, 1, this->step());
+			++_index;
 			return *this;
 		}
 
-		Iterator operator++(int) {
+		constexpr Iterator operator++(int) {
 			Iterator tmp(*this); // copy
 			++*this;
 			return tmp;
 		}
 
-		pointer operator->() {
-			return &(*(*this));
+		constexpr Iterator& operator--() {
+			_value = this->advance(_value, _index, -1, this->step());
+			--_index;
+			return *this;
 		}
 
-	private:
-		Integer _from;
-		Integer _to;
-		Integer _step;
-	};
+		constexpr Iterator operator--(int) {
+			Iterator tmp(*this); // copy
+			--*this;
+			return tmp;
+		}
 
-	using iterator = Iterator;
+		constexpr Iterator& operator+=(difference_type n) {
+			_value = this->advance(_value, _index, n, this->step());
+			_index += static_cast< size_t >(n);
+			return *this;
+		}
+
+		friend constexpr difference_type operator-(const Range::Iterator& a, const Range::Iterator& b) {
+			return static_cast< difference_type >(a._index - b._index);
+		}
+
+		constexpr bool operator<(const Range::Iterator& other) const {
+			return _index < other._index;
+		}
+
+		constexpr value_type operator[](difference_type n) const {
+			return this->advance(_value, _index, n, this->step());
+		}
+
+		constexpr pointer operator->() const {
+			return &(*(*this));
+		}
+
+	private:
+		Integer _value;
+		size_t _index;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+
+	constexpr iterator begin() const {
+		return Iterator(_from, 0, _step);
+	}
+
+	constexpr iterator end() const {
+		return Iterator(_from, _count, _step);
+	}
+
+	constexpr size_t size() const {
+		return _count;
+	}
+
+	template < typename Sink >
+	constexpr bool consume(Sink&& sink) const {
+		for (size_t i = 0; i < _count; ++i) {
+			if (!push(sink, advanceValue(_from, i, _step.step()))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	static constexpr size_t count(Integer from, Integer to, Integer step) {
+		if constexpr (std::is_integral_v< Integer >) {
+			return countExact(from, to, step);
+		} else {
+			return countRounded(from, to, step);
+		}
+	}
+
+	// ceil((to - from) / step), or zero if the step points away from to.
+	// The distance is taken in the unsigned type, where it cannot overflow.
+	static constexpr size_t countExact(Integer from, Integer to, Integer step) {
+		static_assert(std::is_integral_v< Integer >, "exact counts need an integral type");
+		using Unsigned = std::make_unsigned_t< Integer >;
+		if (step > 0 && from < to) {
+			auto distance = static_cast< Unsigned >(static_cast< Unsigned >(to) - static_cast< Unsigned >(from));
+			return static_cast< size_t >((distance - 1) / static_cast< Unsigned >(step)) + 1;
+		}
+		if constexpr (std::is_signed_v< Integer >) {
+			if (step < 0 && from > to) {
+				auto distance = static_cast< Unsigned >(static_cast< Unsigned >(from) - static_cast< Unsigned >(to));
+				auto stride = static_cast< Unsigned >(Unsigned{ 0 } - static_cast< Unsigned >(step));
+				return static_cast< size_t >((distance - 1) / stride) + 1;
+			}
+		}
+		return 0;
+	}
+
+	// The quotient of a floating point range is rounded, so the count is
+	// corrected until from + (count - 1) * step is the last element before
+	// to. Ranges too long to count hold as many elements as size_t does.
+	static constexpr size_t countRounded(Integer from, Integer to, Integer step) {
+		auto before = [&](size_t i) {
+			Integer value = advanceValue(from, i, step);
+			return step > 0 ? value < to : value > to;
+		};
+		if (!((step > 0 && from < to) || (step < 0 && from > to))) {
+			return 0;
+		}
+		Integer quotient = (to - from) / step;
+		if (!(quotient < static_cast< Integer >(std::numeric_limits< size_t >::max() / 2))) {
+			return std::numeric_limits< size_t >::max();
+		}
+		size_t n = static_cast< size_t >(quotient);
+		while (n > 0 && !before(n - 1)) {
+			--n;
+		}
+		while (before(n)) {
+			++n;
+		}
+		return n;
+	}
+
+	Integer _from;
+	size_t _count;
+	Step _step;
+};
+
+template < typename Integer >
+struct InfiniteSequence : public View {
+	using value_type = Integer;
+	using difference_type = std::ptrdiff_t;
+
+	constexpr explicit InfiniteSequence(Integer from, Integer step) : _from(std::move(from)), _step(std::move(step)) { }
+
+	constexpr Integer from() const { return _from; }
+	constexpr Integer step() const { return _step; }
+
+	// Iterators count positions, as the values need not tell them apart: a
+	// zero step repeats the first value, and a floating point step may be
+	// too small to change it. Distances then never divide by the step. The
+	// value at a position is from + i * step.
+	struct Iterator : RandomAccessOperators< Iterator > {
+		using value_type = Integer;
+		using iterator_category = std::random_access_iterator_tag;
+		using difference_type = ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		constexpr Iterator(Integer from, Integer step)
+			: _from(from), _step(std::move(step)), _value(std::move(from)), _index(0) { }
+
+		constexpr bool operator==(const InfiniteSequence< value_type >::Iterator& other) const {
+			return _index == other._index;
+		}
+
+		constexpr bool operator!=(const InfiniteSequence::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		constexpr reference operator*() const {
+			return _value;
+		}
+
+		constexpr Iterator& operator++() {
+			return *this += 1;
+		}
+
+		constexpr Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		constexpr Iterator& operator--() {
+			return *this += -1;
+		}
+
+		constexpr Iterator operator--(int) {
+			Iterator tmp(*this); // copy
+			--*this;
+			return tmp;
+		}
+
+		constexpr Iterator& operator+=(difference_type n) {
+			_index += n;
+			_value = advanceValue(_from, _index, _step);
+			return *this;
+		}
+
+		friend constexpr difference_type operator-(const InfiniteSequence::Iterator& a, const InfiniteSequence::Iterator& b) {
+			return a._index - b._index;
+		}
+
+		constexpr bool operator<(const InfiniteSequence::Iterator& other) const {
+			return _index < other._index;
+		}
+
+		constexpr value_type operator[](difference_type n) const {
+			return advanceValue(_from, _index + n, _step);
+		}
+
+		constexpr pointer operator->() const {
+			return &(*(*this));
+		}
+
+	private:
+		Integer _from;
+		Integer _step;
+		Integer _value;
+		difference_type _index;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+	using sentinel = Unreachable;
+
+	constexpr iterator begin() const {
+		return Iterator(_from, _step);
+	}
+
+	constexpr sentinel end() const {
+		return {};
+	}
+
+	static constexpr bool infinite = true;
+
+	template < typename Sink >
+	constexpr bool consume(Sink&& sink) const {
+		for (difference_type i = 0; ; ++i) {
+			if (!push(sink, advanceValue(_from, i, _step))) {
+				return false;
+			}
+		}
+	}
+
+private:
+	Integer _from;
+	Integer _step;
+};
+
+template < typename As  >
+struct Take : public View {
+	using value_type = typename As::value_type;
+	using difference_type = typename As::difference_type;
+
+	constexpr explicit Take(As inputView, size_t n) : _inputView(std::move(inputView)), _n(n) { }
+
+	// The parts of the view, taken apart when it fuses with the next stage.
+	constexpr const As& source() const& { return _inputView; }
+	constexpr As source() && { return std::move(_inputView); }
+	constexpr size_t count() const { return _n; }
+
+	// A random access source lets the end be placed exactly, the source
+	// iterators then serve as they are.
+	static constexpr bool common = isRandomAccess< typename As::iterator > && ( isCommon< As > || isInfinite< As > );
+
+	// Only used when counting, the source end bounds the count.
+	struct Sentinel {
+		SentinelOf< As > end;
+	};
+
+	struct Iterator {
+		using value_type = typename As::value_type;
+		using iterator_category = std::common_type_t< std::forward_iterator_tag, IteratorCategory< typename As::iterator > >;
+		using difference_type = ptrdiff_t;
+		using pointer = typename std::iterator_traits< typename As::iterator >::pointer;
+		using reference = typename std::iterator_traits< typename As::iterator >::reference;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		constexpr Iterator(typename As::iterator it, size_t n) : _it(std::move(it)), _n(n) { }
+
+		// Iterators of one view count down from the same n.
+		constexpr bool operator==(const Take::Iterator& other) const {
+			return _n == other._n;
+		}	
+
+		constexpr bool operator!=(const Take::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		constexpr bool operator==(const Sentinel& s) const {
+			return _n == 0 || _it == s.end;
+		}
+
+		constexpr bool operator!=(const Sentinel& s) const {
+			return !(*this == s);
+		}
+
+		constexpr reference operator*() const {
+			return *_it;
+		}
+
+		// The source is not advanced past the last element taken, which could
+		// mean another scan of a Filter or even one that never ends.
+		constexpr Iterator& operator++() {
+			if (--_n != 0) {
+				++_it;
+			}
+			return *this;
+		}
+
+		constexpr Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		constexpr pointer operator->() const {
+			return arrow(_it);
+		}
+
+	private:
+		typename As::iterator _it;
+		size_t _n;
+	};
+
+	using iterator = std::conditional_t< common, typename As::iterator, Iterator >;
+	using const_iterator = iterator;
+	using sentinel = std::conditional_t< common, iterator, Sentinel >;
+
+	constexpr iterator begin() const {
+		if constexpr (common) {
+			return _inputView.begin();
+		} else {
+			return Iterator(_inputView.begin(), _n);
+		}
+	}
+
+	constexpr sentinel end() const {
+		if constexpr (common) {
+			auto n = std::min(static_cast< ptrdiff_t >(std::min< size_t >(_n, std::numeric_limits< ptrdiff_t >::max())),
+				boundedDistance(_inputView));
+			return _inputView.begin() + n;
+		} else {
+			return Sentinel{ _inputView.end() };
+		}
+	}
+
+	template < typename V = As, typename = std::enable_if_t< isSized< V > || isInfinite< V > > >
+	constexpr size_t size() const {
+		if constexpr (isInfinite< V >) {
+			return _n;
+		} else {
+			return std::min(_n, detail::size(_inputView));
+		}
+	}
+
+	static constexpr bool allocates = isAllocating< As >;
+
+	// A prefix of contiguous storage is contiguous as well.
+	template < typename V = As, typename = std::enable_if_t< isContiguous< V >() > >
+	constexpr const value_type* data() const {
+		return _inputView.data();
+	}
+
+	template < typename Sink >
+	constexpr bool consume(Sink&& sink) const {
+		if constexpr (isContiguous< As >()) {
+			return consumeArray(_inputView.data(), size(), sink);
+		}
+		size_t left = _n;
+		if (left == 0) {
+			return true;
+		}
+		bool stopped = false;
+		detail::consume(_inputView, [&](auto&& x) {
+			if (!push(sink, std::forward< decltype(x) >(x))) {
+				stopped = true;
+				return false;
+			}
+			return --left != 0;
+		});
+		return !stopped;
+	}
+
+private:
+	As _inputView;
+	size_t _n;
+};
+
+
+// Splits the source into blocks of n elements, the last one possibly
+// shorter. Contiguous sources are cut into spans of their storage and are
+// random access, other sources are copied block by block into a buffer
+// that the iterator reuses. n must not be zero.
+template < typename As, bool Contiguous = isContiguous< As >() >
+struct Chunk : public View {
+	using element_type = typename As::value_type;
+	using value_type = Span< const element_type >;
+	using difference_type = ptrdiff_t;
+
+	explicit Chunk(As inputView, size_t n) : _inputView(std::move(inputView)), _n(n) { }
+
+	const As& source() const { return _inputView; }
+
+	struct Iterator : RandomAccessOperators< Iterator > {
+		using value_type = Span< const element_type >;
+		using iterator_category = std::random_access_iterator_tag;
+		using difference_type = ptrdiff_t;
+		using pointer = ArrowProxy< value_type >;
+		using reference = value_type;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		Iterator(const element_type* data, size_t size, size_t n, size_t index)
+				: _data(data), _size(size), _n(n), _index(index) { }
+
+		bool operator==(const Chunk::Iterator& other) const {
+			return _index == other._index;
+		}
+
+		bool operator!=(const Chunk::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		reference operator*() const {
+			size_t from = _index * _n;
+			return value_type(_data + from, std::min(_n, _size - from));
+		}
+
+		Iterator& operator++() {
+			++_index;
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		Iterator& operator--() {
+			--_index;
+			return *this;
+		}
+
+		Iterator operator--(int) {
+			Iterator tmp(*this); // copy
+			--*this;
+			return tmp;
+		}
+
+		Iterator& operator+=(difference_type n) {
+			_index += n;
+			return *this;
+		}
+
+		friend difference_type operator-(const Chunk::Iterator& a, const Chunk::Iterator& b) {
+			return static_cast< difference_type >(a._index) - static_cast< difference_type >(b._index);
+		}
+
+		bool operator<(const Chunk::Iterator& other) const {
+			return _index < other._index;
+		}
+
+		value_type operator[](difference_type n) const {
+			return *(*this + n);
+		}
+
+		pointer operator->() const {
+			return pointer{ *(*this) };
+		}
+
+	private:
+		const element_type* _data = nullptr;
+		size_t _size = 0;
+		size_t _n = 1;
+		size_t _index = 0;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+	using sentinel = Iterator;
+
+	iterator begin() const {
+		return Iterator(_inputView.data(), _inputView.size(), _n, 0);
+	}
+
+	sentinel end() const {
+		return Iterator(_inputView.data(), _inputView.size(), _n, size());
+	}
+
+	size_t size() const {
+		return (_inputView.size() + _n - 1) / _n;
+	}
+
+	static constexpr bool allocates = isAllocating< As >;
+
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		const element_type* p = _inputView.data();
+		size_t left = _inputView.size();
+		for (; left > 0; p += std::min(_n, left), left -= std::min(_n, left)) {
+			if (!push(sink, value_type(p, std::min(_n, left)))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	As _inputView;
+	size_t _n;
+};
+
+template < typename As >
+struct Chunk< As, false > : public View {
+	using element_type = typename As::value_type;
+	using value_type = Span< const element_type >;
+	using difference_type = ptrdiff_t;
+
+	explicit Chunk(As inputView, size_t n) : _inputView(std::move(inputView)), _n(n) { }
+
+	const As& source() const { return _inputView; }
+
+	// Only used when the source itself ends in a sentinel.
+	struct Sentinel {
+		SentinelOf< As > end;
+	};
+
+	// Holds the current block and the source position after it. The end
+	// is reached when there was nothing left to fill the block with.
+	struct Iterator {
+		using value_type = Span< const element_type >;
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = ptrdiff_t;
+		using pointer = ArrowProxy< value_type >;
+		using reference = value_type;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		Iterator(const Chunk* parent, typename As::iterator it) : _parent(parent), _it(std::move(it)) {
+			fill();
+		}
+
+		bool operator==(const Chunk::Iterator& other) const {
+			return _it == other._it && _buffer.empty() == other._buffer.empty();
+		}
+
+		bool operator!=(const Chunk::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		bool operator==(const Sentinel&) const {
+			return _buffer.empty();
+		}
+
+		bool operator!=(const Sentinel& s) const {
+			return !(*this == s);
+		}
+
+		reference operator*() const {
+			return value_type(_buffer.data(), _buffer.size());
+		}
+
+		Iterator& operator++() {
+			fill();
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		pointer operator->() const {
+			return pointer{ *(*this) };
+		}
+
+	private:
+		void fill() {
+			_buffer.clear();
+			auto end = _parent->_inputView.end();
+			while (_buffer.size() < _parent->_n && _it != end) {
+				_buffer.push_back(*_it);
+				++_it;
+			}
+		}
+
+		const Chunk* _parent = nullptr;
+		typename As::iterator _it;
+		std::vector< element_type > _buffer;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+	using sentinel = std::conditional_t< isCommon< As >, Iterator, Sentinel >;
+
+	iterator begin() const {
+		return Iterator(this, _inputView.begin());
+	}
+
+	sentinel end() const {
+		if constexpr (isCommon< As >) {
+			return Iterator(this, _inputView.end());
+		} else {
+			return Sentinel{ _inputView.end() };
+		}
+	}
+
+	static constexpr bool infinite = isInfinite< As >;
+	static constexpr bool allocates = true;
+
+	template < typename V = As, typename = std::enable_if_t< isSized< V > > >
+	size_t size() const {
+		return (detail::size(_inputView) + _n - 1) / _n;
+	}
+
+	// One buffer serves every block.
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		std::vector< element_type > buffer;
+		buffer.reserve(_n);
+		bool stopped = false;
+		detail::consume(_inputView, [&](auto&& x) {
+			buffer.push_back(std::forward< decltype(x) >(x));
+			if (buffer.size() < _n) {
+				return true;
+			}
+			stopped = !push(sink, value_type(buffer.data(), buffer.size()));
+			buffer.clear();
+			return !stopped;
+		});
+		if (stopped) {
+			return false;
+		}
+		return buffer.empty() || push(sink, value_type(buffer.data(), buffer.size()));
+	}
+
+private:
+	As _inputView;
+	size_t _n;
+};
+
+// Calls f( in, out ) once per block of n source elements with a span of
+// the inputs and a span of as many outputs to fill, and yields the outputs
+// one by one.
+template < typename As, typename Out, typename F >
+struct MapBatched : public View {
+	using value_type = Out;
+	using difference_type = ptrdiff_t;
+
+	explicit MapBatched(As inputView, size_t n, F functor)
+			: _chunks(std::move(inputView), n), _functor(std::move(functor)) { }
+
+	using Chunks = Chunk< As >;
+
+	// Only used when the blocks end in a sentinel.
+	struct Sentinel {
+		SentinelOf< Chunks > end;
+	};
+
+	struct Iterator {
+		using value_type = Out;
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		Iterator(const MapBatched* parent, typename Chunks::iterator chunk, bool atEnd)
+				: _parent(parent), _chunk(std::move(chunk)) {
+			if (!atEnd) {
+				fill();
+			}
+		}
+
+		bool operator==(const MapBatched::Iterator& other) const {
+			return _chunk == other._chunk && _index == other._index;
+		}
+
+		bool operator!=(const MapBatched::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		bool operator==(const Sentinel& s) const {
+			return _chunk == s.end;
+		}
+
+		bool operator!=(const Sentinel& s) const {
+			return !(*this == s);
+		}
+
+		reference operator*() const {
+			return _out[_index];
+		}
+
+		Iterator& operator++() {
+			if (++_index == _out.size()) {
+				++_chunk;
+				_index = 0;
+				fill();
+			}
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		pointer operator->() const {
+			return &_out[_index];
+		}
+
+	private:
+		void fill() {
+			if (_chunk != _parent->_chunks.end()) {
+				_parent->run(*_chunk, _out);
+			}
+		}
+
+		const MapBatched* _parent = nullptr;
+		typename Chunks::iterator _chunk;
+		std::vector< Out > _out;
+		size_t _index = 0;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+	using sentinel = std::conditional_t< isCommon< Chunks >, Iterator, Sentinel >;
+
+	iterator begin() const {
+		return Iterator(this, _chunks.begin(), false);
+	}
+
+	sentinel end() const {
+		if constexpr (isCommon< Chunks >) {
+			return Iterator(this, _chunks.end(), true);
+		} else {
+			return Sentinel{ _chunks.end() };
+		}
+	}
+
+	static constexpr bool infinite = isInfinite< As >;
+	static constexpr bool allocates = true;
+
+	template < typename V = As, typename = std::enable_if_t< isSized< V > > >
+	size_t size() const {
+		return detail::size(_chunks.source());
+	}
+
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		std::vector< Out > out;
+		return detail::consume(_chunks, [&](Span< const typename As::value_type > in) {
+			run(in, out);
+			for (const auto& x : out) {
+				if (!push(sink, x)) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+private:
+	void run(Span< const typename As::value_type > in, std::vector< Out >& out) const {
+		out.resize(in.size());
+		_functor(in, Span< Out >(out.data(), out.size()));
+	}
+
+	Chunks _chunks;
+	F _functor;
+};
+
+} // namespace detail
+
+// Views pass through, containers are wrapped: lvalues by reference,
+// rvalues are moved into an OwningView. Views that cannot be copied, such
+// as named pipelines that own their container, are referenced as lvalues
+// too.
+template < typename T >
+constexpr auto view( T&& t ) {
+    using U = std::remove_cv_t< std::remove_reference_t< T > >;
+    if constexpr ( std::is_base_of_v< detail::View, U > && std::is_lvalue_reference_v< T >
+        && !std::is_copy_constructible_v< U > ) {
+        return detail::RefView< U >{ t };
+    } else if constexpr ( std::is_base_of_v< detail::View, U > ) {
+        return U( std::forward< T >( t ) );
+    } else if constexpr ( std::is_lvalue_reference_v< T > ) {
+        return detail::ContainerView< U >{ t };
+    } else {
+        return detail::OwningView< U >{ std::move( t ) };
+    }
+}
+
+namespace detail {
+
+template < typename As >
+using ViewOf = decltype( view( std::declval< As >() ) );
+
+// Terminals run on a view where it is instead of taking it over, only
+// containers get wrapped.
+template < typename As >
+constexpr decltype( auto ) viewRef( const As& input ) {
+    if constexpr ( std::is_base_of_v< View, As > ) {
+        return ( input );
+    } else {
+        return view( input );
+    }
+}
+
+} // namespace detail
+
+namespace detail {
+
+// Adjacent stages of the same kind fuse into one when a pipeline is built,
+// which saves a level of iterators per stage.
+template < typename V >
+struct IsMap : std::false_type {};
+
+template < typename As, typename F, bool Cached >
+struct IsMap< Map< As, F, Cached > > : std::true_type {};
+
+template < typename V >
+struct IsFilter : std::false_type {};
+
+template < typename As, typename F >
+struct IsFilter< Filter< As, F > > : std::true_type {};
+
+template < typename V >
+struct IsTake : std::false_type {};
+
+template < typename As >
+struct IsTake< Take< As > > : std::true_type {};
+
+template < typename V >
+struct IsInfiniteSequence : std::false_type {};
+
+template < typename Integer >
+struct IsInfiniteSequence< InfiniteSequence< Integer > > : std::true_type {};
+
+// g after f, the functor of a map of a map.
+template < typename F, typename G >
+struct Composition {
+	template < typename T >
+	constexpr auto operator()(T&& x) const -> decltype(std::declval< const G& >()(std::declval< const F& >()(std::forward< T >(x)))) {
+		return g(f(std::forward< T >(x)));
+	}
+
+	F f;
+	G g;
+};
+
+// p and then q, the predicate of a filter of a filter.
+template < typename P, typename Q >
+struct Conjunction {
+	template < typename T >
+	constexpr bool operator()(const T& x) const {
+		return p(x) && q(x);
+	}
+
+	P p;
+	Q q;
+};
+
+// A map of a map applies the composition to the inner source. The result
+// caches if the outer map does, the inner cache goes away.
+template < bool Cached, typename As, typename F >
+constexpr auto makeMap( As&& input, F f ) {
+	using V = ViewOf< As >;
+	if constexpr ( IsMap< V >::value ) {
+		auto inner = view( std::forward< As >( input ) );
+		auto composition = Composition< typename V::Functor, F >{ std::move( inner ).functor(), std::move( f ) };
+		return Map< typename V::Source, decltype( composition ), Cached >{ std::move( inner ).source(), std::move( composition ) };
+	} else {
+		return Map< V, F, Cached >{ view( std::forward< As >( input ) ), std::move( f ) };
+	}
+}
+
+} // namespace detail
+
+template < typename V, typename Constructor >
+constexpr auto operator|( V&& left, detail::RangeBuilder< Constructor > builder ) {
+    return builder.f( view( std::forward< V >( left ) ) );
+}
+
+template < typename As, typename F >
+constexpr auto map( As&& input, F f ) {
+    return detail::makeMap< detail::CacheResults< F >::value >( std::forward< As >( input ), std::move( f ) );
+}
+
+template < typename F >
+constexpr auto map( F f ) {
+    return detail::makeRangeBuilder( [=]( auto input ){
+        return map( std::move( input ), f );
+    } );
+}
+
+// Like map, but the iterators call f on every dereference and return the
+// result by value instead of keeping it, so they stay small and trivially
+// copyable.
+template < typename As, typename F >
+constexpr auto uncachedMap( As&& input, F f ) {
+    return detail::makeMap< false >( std::forward< As >( input ), std::move( f ) );
+}
+
+template < typename F >
+constexpr auto uncachedMap( F f ) {
+    return detail::makeRangeBuilder( [=]( auto input ){
+        return uncachedMap( std::move( input ), f );
+    } );
+}
+
+template < typename As, typename F >
+constexpr auto filter( As&& input, F f ) {
+    using V = detail::ViewOf< As >;
+    if constexpr ( detail::IsFilter< V >::value ) {
+        auto inner = view( std::forward< As >( input ) );
+        auto both = detail::Conjunction< typename V::Predicate, F >{ std::move( inner ).predicate(), std::move( f ) };
+        return detail::Filter{ std::move( inner ).source(), std::move( both ) };
+    } else {
+        return detail::Filter{ view( std::forward< As >( input ) ), std::move( f ) };
+    }
+}
+
+template < typename F >
+constexpr auto filter( F f ) {
+    return detail::makeRangeBuilder( [=]( auto input ){
+        return filter( std::move( input ), f );
+    } );
+}
+
+template < typename As, typename Bs, typename F >
+constexpr auto zipWith( As&& iA, Bs&& iB, F f ) {
+    using ZipWith = detail::ZipWith< detail::ViewOf< As >, detail::ViewOf< Bs >, F, detail::CacheResults< F >::value >;
+    return ZipWith{ view( std::forward< As >( iA ) ), view( std::forward< Bs >( iB ) ), std::move( f ) };
+}
+
+template < typename As, typename Bs, typename F >
+constexpr auto uncachedZipWith( As&& iA, Bs&& iB, F f ) {
+    using ZipWith = detail::ZipWith< detail::ViewOf< As >, detail::ViewOf< Bs >, F, false >;
+    return ZipWith{ view( std::forward< As >( iA ) ), view( std::forward< Bs >( iB ) ), std::move( f ) };
+}
+
+template < typename As, typename Bs >
+constexpr auto zip( As&& iA, Bs&& iB ) {
+    using A = typename detail::ViewOf< As >::value_type;
+    using B = typename detail::ViewOf< Bs >::value_type;
+    return detail::ZipWith{ view( std::forward< As >( iA ) ), view( std::forward< Bs >( iB ) ), 
+		[]( A vA, B vB){ return std::pair {vA, vB}; } };
+}
+
+template < typename Integer >
+constexpr auto range( Integer from, Integer to, Integer step = 1 ) {
+    return detail::Range{ from, to, step };
+}
+
+template < typename Integer >
+constexpr auto range( Integer to ) {
+    if constexpr ( std::is_integral_v< Integer > ) {
+        using Step = detail::StaticStep< Integer, 1 >;
+        return detail::Range< Integer, Step >{ static_cast<Integer>(0), to, static_cast<Integer>(1) };
+    } else {
+        return detail::Range< Integer >{ static_cast<Integer>(0), to, static_cast<Integer>(1) };
+    }
+}
+
+// range with the step fixed at compile time, e.g. range< -2 >( 10, 0 ).
+template < auto Step, typename Integer >
+constexpr auto range( Integer from, Integer to ) {
+    using StepType = detail::StaticStep< Integer, static_cast< Integer >( Step ) >;
+    return detail::Range< Integer, StepType >{ from, to, static_cast< Integer >( Step ) };
+}
+
+template < typename Integer >
+constexpr auto infiniteSequence( Integer from, Integer step = 1 ) {
+	return detail::InfiniteSequence{ from, step };
+}
+
+template < typename As >
+constexpr auto enumerate( As&& a ) {
+	return zip(infiniteSequence(static_cast<size_t >(0)), std::forward< As >(a));
+}
+
+constexpr auto enumerate() {
+	return detail::makeRangeBuilder( []( auto a ) {
+		return zip(infiniteSequence(static_cast<size_t >(0)), std::move(a));
+	} );
+}
+
+// take of a take keeps the smaller count, take of an integral
+// infiniteSequence is a range with a known number of elements. Other
+// sequences keep adding up their steps in a Take.
+template < typename As >
+constexpr auto take( As&& in, size_t n ) {
+	using V = detail::ViewOf< As >;
+	if constexpr ( detail::IsTake< V >::value ) {
+		auto inner = view( std::forward< As >( in ) );
+		size_t count = std::min( n, inner.count() );
+		return detail::Take{ std::move( inner ).source(), count };
+	} else if constexpr ( detail::IsInfiniteSequence< V >::value && std::is_integral_v< typename V::value_type > ) {
+		using Integer = typename V::value_type;
+		return detail::Range< Integer >{ in.from(), n, in.step(), typename detail::Range< Integer >::Counted{} };
+	} else {
+		return detail::Take{ view( std::forward< As >( in ) ), n };
+	}
+}
+
+constexpr auto take( size_t n ) {
+	return detail::makeRangeBuilder( [=]( auto input ){ 
+		return take( std::move( input ), n );
+	} );
+}
+
+namespace detail {
+
+inline size_t checkBlockSize( size_t n, const char* what ) {
+	if ( n == 0 ) {
+		throw std::invalid_argument( std::string( what ) + " needs blocks of at least one element" );
+	}
+	return n;
+}
+
+} // namespace detail
+
+// Blocks of n elements, see detail::Chunk. Throws std::invalid_argument
+// if n is zero.
+template < typename As >
+auto chunk( As&& input, size_t n ) {
+    detail::checkBlockSize( n, "chunk" );
+    return detail::Chunk< detail::ViewOf< As > >{ view( std::forward< As >( input ) ), n };
+}
+
+inline auto chunk( size_t n ) {
+    detail::checkBlockSize( n, "chunk" );
+    return detail::makeRangeBuilder( [=]( auto input ){
+        return detail::Chunk< decltype( input ) >{ std::move( input ), n };
+    } );
+}
+
+// Like map, but f sees n elements at a time: f( in, out ) fills out[ i ]
+// from in[ i ], both spans of the same length. Out is the element type
+// of the result and defaults to the input element type. Throws
+// std::invalid_argument if n is zero.
+template < typename Out = void, typename As, typename F >
+auto mapBatched( As&& input, size_t n, F f ) {
+    detail::checkBlockSize( n, "mapBatched" );
+    using V = detail::ViewOf< As >;
+    using O = std::conditional_t< std::is_void_v< Out >, typename V::value_type, Out >;
+    return detail::MapBatched< V, O, F >{ view( std::forward< As >( input ) ), n, std::move( f ) };
+}
+
+template < typename Out = void, typename F >
+auto mapBatched( size_t n, F f ) {
+    detail::checkBlockSize( n, "mapBatched" );
+    return detail::makeRangeBuilder( [=]( auto input ){
+        return mapBatched< Out >( std::move( input ), n, f );
+    } );
+}
+
+// Calls f with every element of the input in one fused loop. f may return
+// false to stop early, in which case forEach returns false as well.
+template < typename As, typename F >
+bool forEach( const As& input, F f ) {
+	return detail::consume( detail::viewRef( input ), f );
+}
+
+template < typename F >
+auto forEach( F f ) {
+	return detail::makeRangeBuilder( [=]( auto input ){
+		return forEach( input, f );
+	} );
+}
+
+namespace detail {
+
+template < typename C, typename = void >
+struct HasReserve : std::false_type {};
+
+template < typename C >
+struct HasReserve< C, std::void_t< decltype( std::declval< C& >().reserve( size_t{} ) ) > > : std::true_type {};
+
+template < typename C, typename = void >
+struct HasPushBack : std::false_type {};
+
+template < typename C >
+struct HasPushBack< C, std::void_t< decltype( std::declval< C& >().push_back( std::declval< typename C::value_type >() ) ) > >
+	: std::true_type {};
+
+// Contiguous views are appended to sequence containers as one pointer
+// range, converting element by element if need be.
+template < typename C, typename V >
+constexpr bool canInsertArray() {
+	if constexpr ( isContiguous< V >() && HasPushBack< C >::value ) {
+		return std::is_constructible_v< typename C::value_type, const typename V::value_type& >;
+	} else {
+		return false;
+	}
+}
+
+template < typename C >
+struct IsArray : std::false_type {};
+
+template < typename T, size_t N >
+struct IsArray< std::array< T, N > > : std::true_type {};
+
+// The first N elements of the view, the rest of the array stays value
+// initialized if the view is shorter.
+template < typename T, size_t N, typename V >
+constexpr std::array< T, N > toArray( const V& v ) {
+	std::array< T, N > out{};
+	if constexpr ( N > 0 ) {
+		size_t i = 0;
+		detail::consume( v, [&]( auto&& x ) {
+			out[ i ] = std::forward< decltype( x ) >( x );
+			return ++i != N;
+		} );
+	}
+	return out;
+}
+
+// Appends every element of the view to out, reserving once up front when
+// the view knows its size.
+template < typename C, typename V >
+void appendTo( C& out, const V& v ) {
+	if constexpr ( isSized< V > && HasReserve< C >::value ) {
+		out.reserve( out.size() + detail::size( v ) );
+	}
+
+	if constexpr ( canInsertArray< C, V >() ) {
+		out.insert( out.end(), v.data(), v.data() + v.size() );
+	} else {
+		detail::consume( v, [&]( auto&& x ) {
+			if constexpr ( HasPushBack< C >::value ) {
+				out.push_back( std::forward< decltype( x ) >( x ) );
+			} else {
+				out.insert( std::forward< decltype( x ) >( x ) );
+			}
+		} );
+	}
+}
+
+// The container to< C > builds from a template: associative containers
+// split pairs into key and mapped type, everything else holds the
+// elements as they are.
+template < template < typename... > class C, typename T >
+struct CollectedAs {
+	using type = C< T >;
+};
+
+template < typename K, typename M >
+struct CollectedAs< std::map, std::pair< K, M > > {
+	using type = std::map< K, M >;
+};
+
+template < typename K, typename M >
+struct CollectedAs< std::multimap, std::pair< K, M > > {
+	using type = std::multimap< K, M >;
+};
+
+template < typename K, typename M >
+struct CollectedAs< std::unordered_map, std::pair< K, M > > {
+	using type = std::unordered_map< K, M >;
+};
+
+template < typename K, typename M >
+struct CollectedAs< std::unordered_multimap, std::pair< K, M > > {
+	using type = std::unordered_multimap< K, M >;
+};
+
+} // namespace detail
+
+// Materializes the input into a new container of type C, e.g.
+// to< std::string >( input ). A std::array is filled from the front and
+// can be built at compile time, see below.
+template < typename C, typename As >
+constexpr C to( const As& input ) {
+	if constexpr ( detail::IsArray< C >::value ) {
+		return detail::toArray< typename C::value_type, std::tuple_size_v< C > >( detail::viewRef( input ) );
+	} else {
+		C out;
+		detail::appendTo( out, detail::viewRef( input ) );
+		return out;
+	}
+}
+
+template < typename C >
+constexpr auto to() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return to< C >( input );
+	} );
+}
+
+// Same with the element type deduced, e.g. to< std::vector >( input ) or
+// to< std::unordered_map >( enumerate( input ) ).
+template < template < typename... > class C, typename As >
+auto to( const As& input ) {
+	using Element = typename std::decay_t< decltype( detail::viewRef( input ) ) >::value_type;
+	using Collected = typename detail::CollectedAs< C, Element >::type;
+	return to< Collected >( input );
+}
+
+template < template < typename... > class C >
+auto to() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return to< C >( input );
+	} );
+}
+
+// A std::array of N elements with the element type deduced. With a
+// constexpr pipeline the whole table is computed by the compiler, e.g.
+// constexpr auto squares = range( 16 ) | map( square ) | to< std::array, 16 >();
+template < template < typename, size_t > class A, size_t N, typename As >
+constexpr auto to( const As& input ) {
+	using Element = typename std::decay_t< decltype( detail::viewRef( input ) ) >::value_type;
+	return to< A< Element, N > >( input );
+}
+
+template < template < typename, size_t > class A, size_t N >
+constexpr auto to() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return to< A, N >( input );
+	} );
+}
+
+// Replaces the contents of out with the input. The capacity of out is
+// kept, so rebuilding the same buffer over and over does not allocate.
+template < typename C, typename As >
+C& collectInto( const As& input, C& out ) {
+	out.clear();
+	detail::appendTo( out, detail::viewRef( input ) );
+	return out;
+}
+
+template < typename C >
+auto collectInto( C& out ) {
+	return detail::makeRangeBuilder( [&out]( auto input ) -> C& {
+		return collectInto( input, out );
+	} );
+}
+
+namespace detail {
+
+// Binary operations that the reduction kernels know how to run lane-wise.
+struct Add {
+	template < typename T >
+	T operator()( const T& a, const T& b ) const { return a + b; }
+};
+
+struct Min {
+	template < typename T >
+	T operator()( const T& a, const T& b ) const { return b < a ? b : a; }
+};
+
+struct Max {
+	template < typename T >
+	T operator()( const T& a, const T& b ) const { return a < b ? b : a; }
+};
+
+// SIMD registers for T, picked by the instruction set the translation unit
+// is compiled for. Only float and double have them, integer reductions are
+// left to the auto-vectorizer, which may reorder them freely.
+template < typename T >
+struct Lanes {
+	static constexpr bool available = false;
+};
+
+#if defined( __AVX__ )
+
+template <>
+struct Lanes< float > {
+	static constexpr bool available = true;
+	static constexpr size_t width = 8;
+	using type = __m256;
+
+	static type load( const float* p ) { return _mm256_loadu_ps( p ); }
+	static void store( float* p, type v ) { _mm256_storeu_ps( p, v ); }
+	static type apply( Add, type a, type b ) { return _mm256_add_ps( a, b ); }
+	static type apply( Min, type a, type b ) { return _mm256_min_ps( a, b ); }
+	static type apply( Max, type a, type b ) { return _mm256_max_ps( a, b ); }
+};
+
+template <>
+struct Lanes< double > {
+	static constexpr bool available = true;
+	static constexpr size_t width = 4;
+	using type = __m256d;
+
+	static type load( const double* p ) { return _mm256_loadu_pd( p ); }
+	static void store( double* p, type v ) { _mm256_storeu_pd( p, v ); }
+	static type apply( Add, type a, type b ) { return _mm256_add_pd( a, b ); }
+	static type apply( Min, type a, type b ) { return _mm256_min_pd( a, b ); }
+	static type apply( Max, type a, type b ) { return _mm256_max_pd( a, b ); }
+};
+
+#elif defined( __SSE2__ )
+
+template <>
+struct Lanes< float > {
+	static constexpr bool available = true;
+	static constexpr size_t width = 4;
+	using type = __m128;
+
+	static type load( const float* p ) { return _mm_loadu_ps( p ); }
+	static void store( float* p, type v ) { _mm_storeu_ps( p, v ); }
+	static type apply( Add, type a, type b ) { return _mm_add_ps( a, b ); }
+	static type apply( Min, type a, type b ) { return _mm_min_ps( a, b ); }
+	static type apply( Max, type a, type b ) { return _mm_max_ps( a, b ); }
+};
+
+template <>
+struct Lanes< double > {
+	static constexpr bool available = true;
+	static constexpr size_t width = 2;
+	using type = __m128d;
+
+	static type load( const double* p ) { return _mm_loadu_pd( p ); }
+	static void store( double* p, type v ) { _mm_storeu_pd( p, v ); }
+	static type apply( Add, type a, type b ) { return _mm_add_pd( a, b ); }
+	static type apply( Min, type a, type b ) { return _mm_min_pd( a, b ); }
+	static type apply( Max, type a, type b ) { return _mm_max_pd( a, b ); }
+};
+
+#endif
+
+template < typename T, typename Op >
+constexpr bool hasLaneKernel = Lanes< T >::available
+	&& ( std::is_same_v< Op, Add > || std::is_same_v< Op, Min > || std::is_same_v< Op, Max > );
+
+// Reduces at( 0 ) .. at( n - 1 ), n > 0, with four independent accumulators
+// so that consecutive steps do not wait on each other. Like std::reduce,
+// this assumes op to be associative and commutative.
+template < typename At, typename Op >
+auto reduceIndexed( At at, size_t n, Op op ) {
+	using T = std::decay_t< decltype( at( size_t{ 0 } ) ) >;
+	if ( n < 4 ) {
+		T result = at( 0 );
+		for ( size_t i = 1; i < n; ++i ) {
+			result = op( result, at( i ) );
+		}
+		return result;
+	}
+
+	T a0 = at( 0 ), a1 = at( 1 ), a2 = at( 2 ), a3 = at( 3 );
+	size_t i = 4;
+	for ( ; i + 4 <= n; i += 4 ) {
+		a0 = op( a0, at( i ) );
+		a1 = op( a1, at( i + 1 ) );
+		a2 = op( a2, at( i + 2 ) );
+		a3 = op( a3, at( i + 3 ) );
+	}
+	T result = op( op( a0, a1 ), op( a2, a3 ) );
+	for ( ; i < n; ++i ) {
+		result = op( result, at( i ) );
+	}
+	return result;
+}
+
+// Reduces a contiguous buffer of n > 0 elements, four SIMD registers at a
+// time where the instruction set has them.
+template < typename T, typename Op >
+T reduceContiguous( const T* p, size_t n, Op op ) {
+	if constexpr ( hasLaneKernel< T, Op > ) {
+		using L = Lanes< T >;
+		constexpr size_t width = L::width;
+		constexpr size_t block = 4 * width;
+		if ( n >= block ) {
+			auto a0 = L::load( p ), a1 = L::load( p + width );
+			auto a2 = L::load( p + 2 * width ), a3 = L::load( p + 3 * width );
+			size_t i = block;
+			for ( ; i + block <= n; i += block ) {
+				a0 = L::apply( op, a0, L::load( p + i ) );
+				a1 = L::apply( op, a1, L::load( p + i + width ) );
+				a2 = L::apply( op, a2, L::load( p + i + 2 * width ) );
+				a3 = L::apply( op, a3, L::load( p + i + 3 * width ) );
+			}
+			std::array< T, width > lanes;
+			L::store( lanes.data(), L::apply( op, L::apply( op, a0, a1 ), L::apply( op, a2, a3 ) ) );
+			T result = reduceIndexed( [&]( size_t j ) { return lanes[ j ]; }, width, op );
+			for ( ; i < n; ++i ) {
+				result = op( result, p[ i ] );
+			}
+			return result;
+		}
+	}
+	return reduceIndexed( [p]( size_t i ) { return p[ i ]; }, n, op );
+}
+
+// Views that reduce n > 0 elements faster than one at a time provide
+// reduce( op ).
+template < typename V, typename Op, typename = void >
+struct HasReduce : std::false_type {};
+
+template < typename V, typename Op >
+struct HasReduce< V, Op, std::void_t< decltype( std::declval< const V& >().reduce( std::declval< Op >() ) ) > >
+	: std::true_type {};
+
+template < typename V >
+constexpr bool isCountBased() {
+	if constexpr ( isSized< V > && isCommon< V > ) {
+		return isRandomAccess< typename V::iterator >;
+	} else {
+		return false;
+	}
+}
+
+// Reduces all elements of a view with op, empty if there are none.
+// Contiguous buffers of arithmetic types go through the SIMD kernels,
+// views with a reduce of their own use it, other sized random access views
+// are indexed with several accumulators, anything else is folded in order
+// through consume.
+template < typename V, typename Op >
+std::optional< typename V::value_type > reduceView( const V& v, Op op ) {
+	using T = typename V::value_type;
+	if constexpr ( isContiguous< V >() && std::is_arithmetic_v< T > ) {
+		if ( v.size() == 0 ) {
+			return std::nullopt;
+		}
+		return reduceContiguous( v.data(), v.size(), op );
+	} else if constexpr ( HasReduce< V, Op >::value && isSized< V > ) {
+		if ( detail::size( v ) == 0 ) {
+			return std::nullopt;
+		}
+		return v.reduce( op );
+	} else if constexpr ( isCountBased< V >() ) {
+		size_t n = detail::size( v );
+		if ( n == 0 ) {
+			return std::nullopt;
+		}
+		auto it = v.begin();
+		return reduceIndexed( [&]( size_t i ) -> T { return it[ static_cast< std::ptrdiff_t >( i ) ]; }, n, op );
+	} else {
+		std::optional< T > result;
+		detail::consume( v, [&]( auto&& x ) {
+			if ( result ) {
+				result = op( *result, std::forward< decltype( x ) >( x ) );
+			} else {
+				result = std::forward< decltype( x ) >( x );
+			}
+		} );
+		return result;
+	}
+}
+
+// Kahan summation, feeds the rounding error of every addition back into
+// the next one.
+template < typename T, typename V >
+T compensatedSum( const V& v ) {
+	T sum{};
+	T compensation{};
+	detail::consume( v, [&]( const T& x ) {
+		T y = x - compensation;
+		T t = sum + y;
+		compensation = ( t - sum ) - y;
+		sum = t;
+	} );
+	return sum;
+}
+
+// Pairwise summation on a stream: blocks are summed in order and the
+// block sums are combined like the carries of a binary counter, so the
+// error grows with the logarithm of the length.
+template < typename T, typename V >
+T pairwiseSum( const V& v ) {
+	constexpr size_t blockSize = 64;
+	std::array< T, 64 > levels{};
+	std::uint64_t blocks = 0;
+	T block{};
+	size_t inBlock = 0;
+
+	auto carry = [&]( T partial ) {
+		size_t level = 0;
+		for ( ; blocks & ( std::uint64_t{ 1 } << level ); ++level ) {
+			partial = levels[ level ] + partial;
+		}
+		levels[ level ] = partial;
+		++blocks;
+	};
+
+	detail::consume( v, [&]( const T& x ) {
+		block += x;
+		if ( ++inBlock == blockSize ) {
+			carry( block );
+			block = T{};
+			inBlock = 0;
+		}
+	} );
+
+	T result = block;
+	for ( size_t level = 0; level < levels.size(); ++level ) {
+		if ( blocks & ( std::uint64_t{ 1 } << level ) ) {
+			result = levels[ level ] + result;
+		}
+	}
+	return result;
+}
+
+} // namespace detail
+
+// Reduces the input with op starting from init. As with std::reduce, the
+// elements may be combined in any order, so op has to be associative and
+// commutative.
+template < typename As, typename T, typename Op >
+T reduce( const As& input, T init, Op op ) {
+	auto result = detail::reduceView( detail::viewRef( input ), op );
+	return result ? op( init, *result ) : init;
+}
+
+template < typename T, typename Op >
+auto reduce( T init, Op op ) {
+	return detail::makeRangeBuilder( [=]( auto input ){
+		return reduce( input, init, op );
+	} );
+}
+
+// How sum adds up floating point numbers. fast uses independent SIMD
+// accumulators, kahan compensates every rounding error and pairwise keeps
+// the error logarithmic in the length at nearly the speed of fast.
+enum class Summation { fast, kahan, pairwise };
+
+template < typename As >
+auto sum( const As& input, Summation summation = Summation::fast ) {
+	decltype( auto ) v = detail::viewRef( input );
+	using T = typename std::decay_t< decltype( v ) >::value_type;
+	if constexpr ( std::is_floating_point_v< T > ) {
+		if ( summation == Summation::kahan ) {
+			return detail::compensatedSum< T >( v );
+		}
+		if ( summation == Summation::pairwise ) {
+			return detail::pairwiseSum< T >( v );
+		}
+	}
+	return detail::reduceView( v, detail::Add() ).value_or( T{} );
+}
+
+inline auto sum( Summation summation = Summation::fast ) {
+	return detail::makeRangeBuilder( [=]( auto input ){
+		return sum( input, summation );
+	} );
+}
+
+// The smallest element, empty for an empty input.
+template < typename As >
+auto min( const As& input ) {
+	return detail::reduceView( detail::viewRef( input ), detail::Min() );
+}
+
+inline auto min() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return min( input );
+	} );
+}
+
+// The largest element, empty for an empty input.
+template < typename As >
+auto max( const As& input ) {
+	return detail::reduceView( detail::viewRef( input ), detail::Max() );
+}
+
+inline auto max() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return max( input );
+	} );
+}
+
+// The smallest and the largest element, empty for an empty input.
+// Contiguous inputs are scanned twice by the SIMD kernels, everything else
+// once.
+template < typename As >
+auto minmax( const As& input ) {
+	decltype( auto ) v = detail::viewRef( input );
+	using V = std::decay_t< decltype( v ) >;
+	using T = typename V::value_type;
+	std::optional< std::pair< T, T > > result;
+	if constexpr ( detail::isContiguous< V >() && std::is_arithmetic_v< T > ) {
+		auto low = detail::reduceView( v, detail::Min() );
+		if ( low ) {
+			result.emplace( *low, *detail::reduceView( v, detail::Max() ) );
+		}
+	} else {
+		detail::consume( v, [&]( const T& x ) {
+			if ( !result ) {
+				result.emplace( x, x );
+			} else {
+				result->first = detail::Min()( result->first, x );
+				result->second = detail::Max()( result->second, x );
+			}
+		} );
+	}
+	return result;
+}
+
+inline auto minmax() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return minmax( input );
+	} );
+}
+
+namespace detail {
+
+// Position of the first element that no later one beats under better.
+template < typename V, typename Better >
+std::optional< size_t > argBest( const V& v, Better better ) {
+	using T = typename V::value_type;
+	std::optional< T > best;
+	std::optional< size_t > position;
+	size_t index = 0;
+	detail::consume( v, [&]( const T& x ) {
+		if ( !best || better( x, *best ) ) {
+			best = x;
+			position = index;
+		}
+		++index;
+	} );
+	return position;
+}
+
+} // namespace detail
+
+// Index of the first smallest element, empty for an empty input.
+template < typename As >
+std::optional< size_t > argmin( const As& input ) {
+	return detail::argBest( detail::viewRef( input ), std::less<>() );
+}
+
+inline auto argmin() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return argmin( input );
+	} );
+}
+
+// Index of the first largest element, empty for an empty input.
+template < typename As >
+std::optional< size_t > argmax( const As& input ) {
+	return detail::argBest( detail::viewRef( input ), std::greater<>() );
+}
+
+inline auto argmax() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return argmax( input );
+	} );
+}
+
+namespace detail {
+
+// A fixed set of worker threads that help whoever calls run. The caller
+// takes part in its own job and never waits for a helper that has not
+// started yet, so parallel terminals may nest without deadlocking.
+class ThreadPool {
+public:
+	explicit ThreadPool( size_t threads ) {
+		for ( size_t i = 0; i < threads; ++i ) {
+			_workers.emplace_back( [this] { work(); } );
+		}
+	}
+
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard< std::mutex > lock( _mutex );
+			_stopping = true;
+		}
+		_wakeup.notify_all();
+		for ( auto& worker : _workers ) {
+			worker.join();
+		}
+	}
+
+	// Number of threads that run a job, the caller included.
+	size_t concurrency() const { return _workers.size() + 1; }
+
+	// Calls task( i ) for every i in [0, count) on the workers and the
+	// calling thread, returns once all calls finished. The first exception
+	// thrown by a task is rethrown here, the remaining tasks are skipped.
+	template < typename Task >
+	void run( size_t count, Task task ) {
+		if ( count == 0 ) {
+			return;
+		}
+		auto job = std::make_shared< Job< Task > >( count, std::move( task ) );
+		size_t helpers = std::min( count, concurrency() ) - 1;
+		if ( helpers > 0 ) {
+			{
+				std::lock_guard< std::mutex > lock( _mutex );
+				for ( size_t i = 0; i < helpers; ++i ) {
+					_queue.emplace_back( [job] { job->help(); } );
+				}
+			}
+			_wakeup.notify_all();
+		}
+		job->help();
+		job->wait();
+	}
+
+private:
+	template < typename Task >
+	struct Job {
+		Job( size_t count, Task task ) : _count( count ), _task( std::move( task ) ) {}
+
+		void help() {
+			for ( size_t i = _next++; i < _count; i = _next++ ) {
+				if ( !_failed ) {
+					try {
+						_task( i );
+					} catch ( ... ) {
+						std::lock_guard< std::mutex > lock( _mutex );
+						if ( !_error ) {
+							_error = std::current_exception();
+						}
+						_failed = true;
+					}
+				}
+				if ( ++_done == _count ) {
+					std::lock_guard< std::mutex > lock( _mutex );
+					_finished.notify_all();
+				}
+			}
+		}
+
+		void wait() {
+			std::unique_lock< std::mutex > lock( _mutex );
+			_finished.wait( lock, [this] { return _done == _count; } );
+			if ( _error ) {
+				std::rethrow_exception( _error );
+			}
+		}
+
+		size_t _count;
+		Task _task;
+		std::atomic< size_t > _next{ 0 };
+		std::atomic< size_t > _done{ 0 };
+		std::atomic< bool > _failed{ false };
+		std::exception_ptr _error;
+		std::mutex _mutex;
+		std::condition_variable _finished;
+	};
+
+	void work() {
+		while ( true ) {
+			std::function< void() > help;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				_wakeup.wait( lock, [this] { return _stopping || !_queue.empty(); } );
+				if ( _queue.empty() ) {
+					return;
+				}
+				help = std::move( _queue.front() );
+				_queue.pop_front();
+			}
+			help();
+		}
+	}
+
+	std::vector< std::thread > _workers;
+	std::deque< std::function< void() > > _queue;
+	std::mutex _mutex;
+	std::condition_variable _wakeup;
+	bool _stopping = false;
+};
+
+// The pool behind the par* terminals, one thread per hardware thread.
+inline ThreadPool& threadPool() {
+	static ThreadPool pool( std::max( std::thread::hardware_concurrency(), 1u ) - 1 );
+	return pool;
+}
+
+// Keeps values written by different threads on different cache lines.
+constexpr size_t cacheLineSize = 64;
+
+template < typename T >
+struct alignas( cacheLineSize ) Padded {
+	T value;
+};
+
+// Elements handed to one task at least, smaller inputs are not worth the
+// wakeups.
+constexpr size_t parallelGrain = 1024;
+
+// Splits [0, n) into roughly equal slices, a few per thread so that
+// uneven functors still balance, and calls task( slice, begin, end ).
+template < typename Task >
+void parallelSlices( size_t n, Task task ) {
+	auto& pool = threadPool();
+	size_t slices = std::min( ( n + parallelGrain - 1 ) / parallelGrain, 4 * pool.concurrency() );
+	if ( slices <= 1 ) {
+		if ( n > 0 ) {
+			task( 0, 0, n );
+		}
+		return;
+	}
+	pool.run( slices, [&]( size_t slice ) {
+		task( slice, slice * n / slices, ( slice + 1 ) * n / slices );
+	} );
+}
+
+// Reduces the n > 0 elements starting at the index from.
+template < typename V, typename Op >
+typename V::value_type reduceSlice( const V& v, size_t from, size_t n, Op op ) {
+	using T = typename V::value_type;
+	if constexpr ( isContiguous< V >() && std::is_arithmetic_v< T > ) {
+		return reduceContiguous( v.data() + from, n, op );
+	} else {
+		auto it = v.begin() + static_cast< std::ptrdiff_t >( from );
+		return reduceIndexed( [&]( size_t i ) -> T { return it[ static_cast< std::ptrdiff_t >( i ) ]; }, n, op );
+	}
+}
+
+template < typename V, typename Op >
+std::optional< typename V::value_type > parallelReduceView( const V& v, Op op ) {
+	using T = typename V::value_type;
+	if constexpr ( isCountBased< V >() ) {
+		size_t n = detail::size( v );
+		std::vector< Padded< std::optional< T > > > partial( std::min( n, 4 * threadPool().concurrency() ) );
+		parallelSlices( n, [&]( size_t slice, size_t from, size_t to ) {
+			partial[ slice ].value = reduceSlice( v, from, to - from, op );
+		} );
+		std::optional< T > result;
+		for ( auto& p : partial ) {
+			if ( p.value ) {
+				result = result ? op( *result, *p.value ) : *p.value;
+			}
+		}
+		return result;
+	} else {
+		return reduceView( v, op );
+	}
+}
+
+} // namespace detail
+
+// Like reduce, but splits sized random access inputs (containers, range,
+// map and zipWith over those) into slices that are reduced on all cores.
+// op has to be associative and commutative, and every functor in the
+// pipeline has to be safe to call concurrently. Other inputs, such as
+// filters, are reduced on the calling thread.
+template < typename As, typename T, typename Op >
+T parReduce( const As& input, T init, Op op ) {
+	auto result = detail::parallelReduceView( detail::viewRef( input ), op );
+	return result ? op( init, *result ) : init;
+}
+
+template < typename T, typename Op >
+auto parReduce( T init, Op op ) {
+	return detail::makeRangeBuilder( [=]( auto input ){
+		return parReduce( input, init, op );
+	} );
+}
+
+// Parallel sum, reassociated like Summation::fast.
+template < typename As >
+auto parSum( const As& input ) {
+	decltype( auto ) v = detail::viewRef( input );
+	using T = typename std::decay_t< decltype( v ) >::value_type;
+	return detail::parallelReduceView( v, detail::Add() ).value_or( T{} );
+}
+
+inline auto parSum() {
+	return detail::makeRangeBuilder( []( auto input ){
+		return parSum( input );
+	} );
+}
+
+// Calls f with every element, concurrently and in no particular order for
+// sized random access inputs. Unlike forEach, f cannot stop the loop.
+template < typename As, typename F >
+void parForEach( const As& input, F f ) {
+	decltype( auto ) v = detail::viewRef( input );
+	using V = std::decay_t< decltype( v ) >;
+	if constexpr ( detail::isCountBased< V >() ) {
+		detail::parallelSlices( detail::size( v ), [&]( size_t, size_t from, size_t to ) {
+			auto it = v.begin() + static_cast< std::ptrdiff_t >( from );
+			for ( size_t i = from; i < to; ++i, ++it ) {
+				f( *it );
+			}
+		} );
+	} else {
+		detail::consume( v, [&]( auto&& x ) {
+			f( std::forward< decltype( x ) >( x ) );
+		} );
+	}
+}
+
+template < typename F >
+auto parForEach( F f ) {
+	return detail::makeRangeBuilder( [=]( auto input ){
+		parForEach( input, f );
+	} );
+}
+
+namespace detail {
+
+// Bytes in the widest vector register the translation unit is compiled for.
+#if defined( __AVX__ )
+constexpr size_t vectorBytes = 32;
+#else
+constexpr size_t vectorBytes = 16;
+#endif
+
+template < typename T >
+constexpr size_t nativeWidth = vectorBytes / sizeof( T ) > 0 ? vectorBytes / sizeof( T ) : 1;
+
+// N lanes of T with element-wise arithmetic, the argument that mapSimd
+// functors see in place of a single element. The fixed-length loops
+// compile to single vector instructions, no intrinsics needed.
+template < typename T, size_t N >
+struct alignas( N * sizeof( T ) ) Pack {
+	using value_type = T;
+	static constexpr size_t width = N;
+
+	static Pack load( const T* p ) {
+		Pack result;
+		for ( size_t i = 0; i < N; ++i ) {
+			result._lanes[ i ] = p[ i ];
+		}
+		return result;
+	}
+
+	static Pack broadcast( T x ) {
+		Pack result;
+		for ( size_t i = 0; i < N; ++i ) {
+			result._lanes[ i ] = x;
+		}
+		return result;
+	}
+
+	void store( T* p ) const {
+		for ( size_t i = 0; i < N; ++i ) {
+			p[ i ] = _lanes[ i ];
+		}
+	}
+
+	T& operator[]( size_t i ) { return _lanes[ i ]; }
+	const T& operator[]( size_t i ) const { return _lanes[ i ]; }
+
+	template < typename Op >
+	friend Pack apply( Pack a, const Pack& b, Op op ) {
+		for ( size_t i = 0; i < N; ++i ) {
+			a._lanes[ i ] = op( a._lanes[ i ], b._lanes[ i ] );
+		}
+		return a;
+	}
+
+	friend Pack operator+( const Pack& a, const Pack& b ) { return apply( a, b, std::plus<>() ); }
+	friend Pack operator-( const Pack& a, const Pack& b ) { return apply( a, b, std::minus<>() ); }
+	friend Pack operator*( const Pack& a, const Pack& b ) { return apply( a, b, std::multiplies<>() ); }
+	friend Pack operator/( const Pack& a, const Pack& b ) { return apply( a, b, std::divides<>() ); }
+
+	// Scalars are broadcast to every lane.
+	friend Pack operator+( const Pack& a, T b ) { return a + broadcast( b ); }
+	friend Pack operator-( const Pack& a, T b ) { return a - broadcast( b ); }
+	friend Pack operator*( const Pack& a, T b ) { return a * broadcast( b ); }
+	friend Pack operator/( const Pack& a, T b ) { return a / broadcast( b ); }
+	friend Pack operator+( T a, const Pack& b ) { return broadcast( a ) + b; }
+	friend Pack operator-( T a, const Pack& b ) { return broadcast( a ) - b; }
+	friend Pack operator*( T a, const Pack& b ) { return broadcast( a ) * b; }
+	friend Pack operator/( T a, const Pack& b ) { return broadcast( a ) / b; }
+
+	friend Pack operator-( const Pack& a ) { return broadcast( T{} ) - a; }
+
+	Pack& operator+=( const Pack& b ) { return *this = *this + b; }
+	Pack& operator-=( const Pack& b ) { return *this = *this - b; }
+	Pack& operator*=( const Pack& b ) { return *this = *this * b; }
+	Pack& operator/=( const Pack& b ) { return *this = *this / b; }
+
+private:
+	std::array< T, N > _lanes;
+};
+
+// Map over a contiguous buffer of numbers. Iterators apply f to single
+// elements, consume applies it to whole Packs and finishes the remainder
+// element by element.
+template < typename As, typename F >
+struct MapSimd : public View {
+	using element_type = typename As::value_type;
+	using value_type = std::invoke_result_t< const F&, element_type >;
+	using difference_type = ptrdiff_t;
+
+	static constexpr size_t width = nativeWidth< element_type >;
+	using Lanes = Pack< element_type, width >;
+
+	static_assert(std::is_same_v< std::invoke_result_t< const F&, Lanes >, Pack< value_type, width > >,
+		"mapSimd functor must map a Pack of elements to a Pack of its results");
+
+	explicit MapSimd(As inputView, F functor) : _inputView(std::move(inputView)), _functor(std::move(functor)) { }
+
+	struct Iterator : RandomAccessOperators< Iterator > {
+		using value_type = std::invoke_result_t< const F&, element_type >;
+		using iterator_category = std::random_access_iterator_tag;
+		using difference_type = ptrdiff_t;
+		using pointer = ArrowProxy< value_type >;
+		using reference = value_type;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		Iterator(const element_type* p, const F* functor) : _p(p), _functor(functor) { }
+
+		bool operator==(const MapSimd::Iterator& other) const {
+			return _p == other._p;
+		}
+
+		bool operator!=(const MapSimd::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		reference operator*() const {
+			return (*_functor)(*_p);
+		}
+
+		Iterator& operator++() {
+			++_p;
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		Iterator& operator--() {
+			--_p;
+			return *this;
+		}
+
+		Iterator operator--(int) {
+			Iterator tmp(*this); // copy
+			--*this;
+			return tmp;
+		}
+
+		Iterator& operator+=(difference_type n) {
+			_p += n;
+			return *this;
+		}
+
+		friend difference_type operator-(const MapSimd::Iterator& a, const MapSimd::Iterator& b) {
+			return a._p - b._p;
+		}
+
+		bool operator<(const MapSimd::Iterator& other) const {
+			return _p < other._p;
+		}
+
+		value_type operator[](difference_type n) const {
+			return (*_functor)(_p[n]);
+		}
+
+		pointer operator->() const {
+			return pointer{ *(*this) };
+		}
+
+	private:
+		const element_type* _p = nullptr;
+		const F* _functor = nullptr;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+	using sentinel = Iterator;
+
+	iterator begin() const {
+		return Iterator(_inputView.data(), &_functor);
+	}
+
+	sentinel end() const {
+		return Iterator(_inputView.data() + size(), &_functor);
+	}
+
+	size_t size() const {
+		return _inputView.size();
+	}
+
+	// Reduces the n > 0 results a Pack at a time, the lanes serve as
+	// independent accumulators.
+	template < typename Op >
+	value_type reduce(Op op) const {
+		const element_type* p = _inputView.data();
+		size_t n = size();
+		if (n < width) {
+			return reduceIndexed([&](size_t i) { return _functor(p[i]); }, n, op);
+		}
+		auto lanes = _functor(Lanes::load(p));
+		size_t i = width;
+		for (; i + width <= n; i += width) {
+			lanes = apply(lanes, _functor(Lanes::load(p + i)), op);
+		}
+		value_type result = reduceIndexed([&](size_t lane) { return lanes[lane]; }, width, op);
+		for (; i < n; ++i) {
+			result = op(result, _functor(p[i]));
+		}
+		return result;
+	}
+
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		const element_type* p = _inputView.data();
+		size_t n = size();
+		size_t i = 0;
+		for (; i + width <= n; i += width) {
+			auto results = _functor(Lanes::load(p + i));
+			for (size_t lane = 0; lane < width; ++lane) {
+				if (!push(sink, results[lane])) {
+					return false;
+				}
+			}
+		}
+		for (; i < n; ++i) {
+			if (!push(sink, _functor(p[i]))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	As _inputView;
+	F _functor;
+};
+
+} // namespace detail
+
+// Like map, with f written generically so that it also accepts a
+// detail::Pack of elements, e.g. []( auto x ) { return x * 2.0f + 1.0f; }.
+// Contiguous containers of numbers are then transformed a vector register
+// at a time by terminals, other sources fall back to uncachedMap.
+template < typename As, typename F >
+auto mapSimd( As&& input, F f ) {
+    using V = detail::ViewOf< As >;
+    if constexpr ( detail::isContiguous< V >() && std::is_arithmetic_v< typename V::value_type > ) {
+        return detail::MapSimd< V, F >{ view( std::forward< As >( input ) ), std::move( f ) };
+    } else {
+        return uncachedMap( std::forward< As >( input ), std::move( f ) );
+    }
+}
+
+template < typename F >
+auto mapSimd( F f ) {
+    return detail::makeRangeBuilder( [=]( auto input ){
+        return mapSimd( std::move( input ), f );
+    } );
+}
+
+// Per-stage statistics. With RANGE_INSTRUMENT defined, instrument( "name" )
+// counts what passes through the point of the pipeline where it sits, and
+// RANGE_INSTRUMENT_TIMING adds the time spent upstream of it. Without
+// RANGE_INSTRUMENT the adaptor hands its input back unchanged.
+namespace detail {
+
+struct StageStats {
+	std::string name;
+	// Set when a stage is instrumented, which may race with a report.
+	std::atomic< const char* > kind{ "stage" };
+	std::atomic< std::uint64_t > elements{ 0 };
+	std::atomic< std::uint64_t > dereferences{ 0 };
+	std::atomic< std::uint64_t > calls{ 0 };
+	std::atomic< std::uint64_t > passed{ 0 };
+	std::atomic< std::uint64_t > cycles{ 0 };
+};
+
+// Stages by name. Entries live as long as the program, so views can keep
+// plain pointers to them.
+class StageRegistry {
+public:
+	StageStats& stage( std::string_view name ) {
+		std::lock_guard< std::mutex > lock( _mutex );
+		for ( auto& stats : _stages ) {
+			if ( stats->name == name ) {
+				return *stats;
+			}
+		}
+		_stages.push_back( std::make_unique< StageStats >() );
+		_stages.back()->name = std::string( name );
+		return *_stages.back();
+	}
+
+	template < typename F >
+	void each( F f ) {
+		std::lock_guard< std::mutex > lock( _mutex );
+		for ( auto& stats : _stages ) {
+			f( *stats );
+		}
+	}
+
+private:
+	std::mutex _mutex;
+	std::vector< std::unique_ptr< StageStats > > _stages;
+};
+
+inline StageRegistry& stageRegistry() {
+	static StageRegistry registry;
+	return registry;
+}
+
+// s as the contents of a JSON string.
+inline std::string jsonEscape( std::string_view s ) {
+	std::string out;
+	for ( char c : s ) {
+		if ( c == '"' || c == '\\' ) {
+			out += '\\';
+			out += c;
+		} else if ( static_cast< unsigned char >( c ) < 0x20 ) {
+			char escaped[ 8 ];
+			std::snprintf( escaped, sizeof( escaped ), "\\u%04x", static_cast< unsigned >( c ) );
+			out += escaped;
+		} else {
+			out += c;
+		}
+	}
+	return out;
+}
+
+inline void count( std::atomic< std::uint64_t >& counter ) {
+	counter.fetch_add( 1, std::memory_order_relaxed );
+}
+
+#if defined( RANGE_INSTRUMENT_TIMING )
+
+// Time stamp counter cycles on x86, nanoseconds elsewhere.
+inline std::uint64_t readClock() {
+#if defined( __x86_64__ ) || defined( __i386__ )
+	return __rdtsc();
+#else
+	return static_cast< std::uint64_t >( std::chrono::steady_clock::now().time_since_epoch().count() );
+#endif
+}
+
+// Adds the time from construction or resume to destruction or pause.
+struct UpstreamClock {
+	explicit UpstreamClock( StageStats* stats ) : _stats( stats ), _start( readClock() ) {}
+	~UpstreamClock() { pause(); }
+
+	UpstreamClock( const UpstreamClock& ) = delete;
+	UpstreamClock& operator=( const UpstreamClock& ) = delete;
+
+	void pause() {
+		if ( _running ) {
+			_stats->cycles.fetch_add( readClock() - _start, std::memory_order_relaxed );
+			_running = false;
+		}
+	}
+
+	void resume() {
+		_start = readClock();
+		_running = true;
+	}
+
+private:
+	StageStats* _stats;
+	std::uint64_t _start;
+	bool _running = true;
+};
+
+#else
+
+struct UpstreamClock {
+	explicit UpstreamClock( StageStats* ) {}
+	void pause() {}
+	void resume() {}
+};
+
+#endif
+
+// The functor of an instrumented Map, counts its calls.
+template < typename F >
+struct CountCalls {
+	template < typename... Ts >
+	decltype( auto ) operator()( Ts&&... xs ) const {
+		count( stats->calls );
+		return f( std::forward< Ts >( xs )... );
+	}
+
+	F f;
+	StageStats* stats;
+};
+
+template < typename F >
+struct CacheResults< CountCalls< F > > : CacheResults< F > {};
+
+// The predicate of an instrumented Filter, counts calls and matches.
+template < typename F >
+struct CountPasses {
+	template < typename T >
+	bool operator()( const T& x ) const {
+		count( stats->calls );
+		bool pass = f( x );
+		if ( pass ) {
+			count( stats->passed );
+		}
+		return pass;
+	}
+
+	F f;
+	StageStats* stats;
+};
+
+// Passes the source through and counts elements and dereferences on the
+// way.
+template < typename As >
+struct Instrument : public View {
+	using value_type = typename As::value_type;
+	using difference_type = typename As::difference_type;
+
+	explicit Instrument(As inputView, StageStats* stats) : _inputView(std::move(inputView)), _stats(stats) { }
+
+	// Only used when the source itself ends in a sentinel.
+	struct Sentinel {
+		SentinelOf< As > end;
+	};
+
+	struct Iterator : RandomAccessOperators< Iterator > {
+		using value_type = typename As::value_type;
+		using iterator_category = CommonCategory< typename As::iterator >;
+		using difference_type = ptrdiff_t;
+		using pointer = typename std::iterator_traits< typename As::iterator >::pointer;
+		using reference = typename std::iterator_traits< typename As::iterator >::reference;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		Iterator(typename As::iterator it, StageStats* stats) : _it(std::move(it)), _stats(stats) { }
+
+		bool operator==(const Instrument::Iterator& other) const {
+			return _it == other._it;
+		}
+
+		bool operator!=(const Instrument::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		bool operator==(const Sentinel& s) const {
+			return _it == s.end;
+		}
+
+		bool operator!=(const Sentinel& s) const {
+			return !(*this == s);
+		}
+
+		reference operator*() const {
+			count(_stats->dereferences);
+			UpstreamClock clock(_stats);
+			return *_it;
+		}
+
+		Iterator& operator++() {
+			count(_stats->elements);
+			UpstreamClock clock(_stats);
+			++_it;
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		Iterator& operator--() {
+			--_it;
+			return *this;
+		}
+
+		Iterator operator--(int) {
+			Iterator tmp(*this); // copy
+			--*this;
+			return tmp;
+		}
+
+		Iterator& operator+=(difference_type n) {
+			_it += n;
+			return *this;
+		}
+
+		friend difference_type operator-(const Instrument::Iterator& a, const Instrument::Iterator& b) {
+			return a._it - b._it;
+		}
+
+		bool operator<(const Instrument::Iterator& other) const {
+			return _it < other._it;
+		}
+
+		value_type operator[](difference_type n) const {
+			count(_stats->dereferences);
+			UpstreamClock clock(_stats);
+			return _it[n];
+		}
+
+		pointer operator->() const {
+			count(_stats->dereferences);
+			return arrow(_it);
+		}
+
+	private:
+		typename As::iterator _it;
+		StageStats* _stats = nullptr;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+	using sentinel = std::conditional_t< isCommon< As >, Iterator, Sentinel >;
+
+	iterator begin() const {
+		UpstreamClock clock(_stats);
+		return Iterator(_inputView.begin(), _stats);
+	}
+
+	sentinel end() const {
+		if constexpr (isCommon< As >) {
+			return Iterator(_inputView.end(), _stats);
+		} else {
+			return Sentinel{ _inputView.end() };
+		}
+	}
+
+	static constexpr bool infinite = isInfinite< As >;
+	static constexpr bool allocates = isAllocating< As >;
+
+	template < typename V = As, typename = std::enable_if_t< isSized< V > > >
+	size_t size() const {
+		return detail::size(_inputView);
+	}
+
+	// Time spent in the sink belongs downstream and is left out.
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		UpstreamClock clock(_stats);
+		return detail::consume(_inputView, [&](auto&& x) {
+			clock.pause();
+			count(_stats->elements);
+			count(_stats->dereferences);
+			bool more = push(sink, std::forward< decltype(x) >(x));
+			clock.resume();
+			return more;
+		});
+	}
+
+private:
+	As _inputView;
+	StageStats* _stats;
+};
+
+// A Map or Filter right before the instrument gets its functor counted too.
+template < typename As >
+auto makeInstrument( As&& input, StageStats& stats ) {
+	using V = ViewOf< As >;
+	if constexpr ( IsMap< V >::value ) {
+		stats.kind.store( "map", std::memory_order_relaxed );
+		auto inner = view( std::forward< As >( input ) );
+		using Counted = CountCalls< typename V::Functor >;
+		auto counted = Map< typename V::Source, Counted, V::cached >{ std::move( inner ).source(), Counted{ std::move( inner ).functor(), &stats } };
+		return Instrument< decltype( counted ) >{ std::move( counted ), &stats };
+	} else if constexpr ( IsFilter< V >::value ) {
+		stats.kind.store( "filter", std::memory_order_relaxed );
+		auto inner = view( std::forward< As >( input ) );
+		using Counted = CountPasses< typename V::Predicate >;
+		auto counted = Filter< typename V::Source, Counted >{ std::move( inner ).source(), Counted{ std::move( inner ).predicate(), &stats } };
+		return Instrument< decltype( counted ) >{ std::move( counted ), &stats };
+	} else {
+		return Instrument< V >{ view( std::forward< As >( input ) ), &stats };
+	}
+}
+
+} // namespace detail
+
+// Marks a point of the pipeline whose traffic is reported under name by
+// instrumentReport. When the stage before is a map or a filter, its calls
+// are counted as well, which gives the selectivity of a filter and the
+// calls per dereference of a map. Stages with the same name share their
+// counters.
+template < typename As >
+auto instrument( As&& input, std::string_view name ) {
+#if defined( RANGE_INSTRUMENT )
+    return detail::makeInstrument( std::forward< As >( input ), detail::stageRegistry().stage( name ) );
+#else
+    (void) name;
+    return view( std::forward< As >( input ) );
+#endif
+}
+
+inline auto instrument( std::string_view name ) {
+#if defined( RANGE_INSTRUMENT )
+    return detail::makeRangeBuilder( [stats = &detail::stageRegistry().stage( name )]( auto input ){
+        return detail::makeInstrument( std::move( input ), *stats );
+    } );
+#else
+    (void) name;
+    return detail::makeRangeBuilder( []( auto input ){
+        return input;
+    } );
+#endif
+}
+
+enum class ReportFormat { text, json };
+
+// The counters of every instrumented stage so far, one line per stage or
+// one JSON array. cycles stay zero unless RANGE_INSTRUMENT_TIMING is set.
+inline std::string instrumentReport( ReportFormat format = ReportFormat::text ) {
+    std::string out = format == ReportFormat::json ? "[" : "";
+    bool first = true;
+    detail::stageRegistry().each( [&]( const detail::StageStats& stats ) {
+        auto load = []( const std::atomic< std::uint64_t >& counter ) {
+            return std::to_string( counter.load( std::memory_order_relaxed ) );
+        };
+        std::uint64_t calls = stats.calls.load( std::memory_order_relaxed );
+        std::string kind = stats.kind.load( std::memory_order_relaxed );
+        char ratio[ 32 ] = "";
+        if ( calls > 0 && kind == "filter" ) {
+            std::snprintf( ratio, sizeof( ratio ), "%.4f", static_cast< double >( stats.passed.load() ) / static_cast< double >( calls ) );
+        } else if ( kind == "map" && stats.dereferences.load() > 0 ) {
+            std::snprintf( ratio, sizeof( ratio ), "%.4f", static_cast< double >( calls ) / static_cast< double >( stats.dereferences.load() ) );
+        }
+        const char* ratioName = kind == "filter" ? "selectivity" : "calls_per_dereference";
+
+        if ( format == ReportFormat::json ) {
+            out += first ? "\n" : ",\n";
+            out += "  {\"name\": \"" + detail::jsonEscape( stats.name ) + "\", \"kind\": \"" + kind + "\"";
+            out += ", \"elements\": " + load( stats.elements ) + ", \"dereferences\": " + load( stats.dereferences );
+            out += ", \"calls\": " + load( stats.calls ) + ", \"passed\": " + load( stats.passed );
+            out += ", \"cycles\": " + load( stats.cycles );
+            if ( ratio[ 0 ] ) {
+                out += std::string( ", \"" ) + ratioName + "\": " + ratio;
+            }
+            out += "}";
+        } else {
+            out += stats.name + " (" + kind + "): elements " + load( stats.elements ) + ", dereferences " + load( stats.dereferences );
+            out += ", calls " + load( stats.calls ) + ", passed " + load( stats.passed ) + ", cycles " + load( stats.cycles );
+            if ( ratio[ 0 ] ) {
+                out += std::string( ", " ) + ratioName + " " + ratio;
+            }
+            out += "\n";
+        }
+        first = false;
+    } );
+    if ( format == ReportFormat::json ) {
+        out += first ? "]\n" : "\n]\n";
+    }
+    return out;
+}
+
+// Sets every counter back to zero, the stages stay registered.
+inline void resetInstruments() {
+    detail::stageRegistry().each( []( detail::StageStats& stats ) {
+        for ( auto* counter : { &stats.elements, &stats.dereferences, &stats.calls, &stats.passed, &stats.cycles } ) {
+            counter->store( 0, std::memory_order_relaxed );
+        }
+    } );
+}
+
+// What a pipeline costs to iterate, known at compile time, e.g.
+// static_assert( PipelineTraits< decltype( pipeline ) >::iteratorSize <= 32 ).
+// Every stage nests the iterators of the stages before it, so the
+// footprint grows with the length of the pipeline.
+template < typename V >
+struct PipelineTraits {
+    using iterator = typename V::iterator;
+    using sentinel = detail::SentinelOf< V >;
+    using category = detail::IteratorCategory< iterator >;
+
+    static constexpr size_t viewSize = sizeof( V );
+    static constexpr size_t iteratorSize = sizeof( iterator );
+    static constexpr size_t sentinelSize = sizeof( sentinel );
+    static constexpr bool randomAccess = detail::isRandomAccess< iterator >;
+    static constexpr bool common = detail::isCommon< V >;
+    static constexpr bool sized = detail::isSized< V >;
+    static constexpr bool infinite = detail::isInfinite< V >;
+    static constexpr bool contiguous = detail::isContiguous< V >();
+    // Iteration allocates buffers of its own, as chunk and mapBatched do
+    // for sources that are not contiguous.
+    static constexpr bool allocates = detail::isAllocating< V >;
+    // Copies are plain memory copies and the iterator can live in registers.
+    static constexpr bool triviallyCopyable = std::is_trivially_copyable_v< iterator >;
+};
+
+namespace detail {
+
+// First c in [p, end), or end. Compares a vector register worth of bytes
+// at a time.
+inline const char* findByte( const char* p, const char* end, char c ) {
+#if defined( __AVX2__ )
+	const __m256i needle = _mm256_set1_epi8( c );
+	for ( ; end - p >= 32; p += 32 ) {
+		__m256i bytes = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( p ) );
+		unsigned mask = static_cast< unsigned >( _mm256_movemask_epi8( _mm256_cmpeq_epi8( bytes, needle ) ) );
+		if ( mask != 0 ) {
+			return p + __builtin_ctz( mask );
+		}
+	}
+#elif defined( __SSE2__ )
+	const __m128i needle = _mm_set1_epi8( c );
+	for ( ; end - p >= 16; p += 16 ) {
+		__m128i bytes = _mm_loadu_si128( reinterpret_cast< const __m128i* >( p ) );
+		unsigned mask = static_cast< unsigned >( _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, needle ) ) );
+		if ( mask != 0 ) {
+			return p + __builtin_ctz( mask );
+		}
+	}
+#endif
+	for ( ; p != end; ++p ) {
+		if ( *p == c ) {
+			return p;
+		}
+	}
+	return end;
+}
+
+} // namespace detail
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+
+// Hints for mapping a file, none of them changes what a view yields.
+// populate faults the whole file in up front (MAP_POPULATE) instead of
+// page by page, hugePages asks for transparent huge pages where the file
+// system supports them. Both are ignored where the system lacks them.
+struct MappingOptions {
+    bool populate = false;
+    bool hugePages = false;
+};
+
+// The optional header of a file for mmapArray, followed by the elements
+// at offset dataOffset. Files written for mmapArray< T > start with
+// MappedArrayHeader::of< T >( count, version ).
+struct MappedArrayHeader {
+    static constexpr char expectedMagic[ 8 ] = { 'R', 'A', 'N', 'G', 'E', 'A', 'R', 'R' };
+    static constexpr size_t dataOffset = 64;
+
+    char magic[ 8 ];
+    std::uint32_t version;
+    std::uint32_t elementSize;
+    std::uint64_t count;
+
+    template < typename T >
+    static MappedArrayHeader of( std::uint64_t count, std::uint32_t version = 0 ) {
+        MappedArrayHeader header{};
+        std::copy( std::begin( expectedMagic ), std::end( expectedMagic ), header.magic );
+        header.version = version;
+        header.elementSize = sizeof( T );
+        header.count = count;
+        return header;
+    }
+};
+
+namespace detail {
+
+// A read-only mapping of a whole file. Views share it through a
+// shared_ptr, so copying them stays cheap and the string_views they hand
+// out stay valid as long as any copy lives.
+class MappedFile {
+public:
+	MappedFile( const std::string& path, int advice, const MappingOptions& options = {} ) {
+		int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+		if ( fd < 0 ) {
+			throw std::system_error( errno, std::generic_category(), "cannot open " + path );
+		}
+		struct stat info;
+		if ( ::fstat( fd, &info ) != 0 ) {
+			int error = errno;
+			::close( fd );
+			throw std::system_error( error, std::generic_category(), "cannot stat " + path );
+		}
+		_size = static_cast< size_t >( info.st_size );
+		if ( _size > 0 ) {
+			int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+			flags |= options.populate ? MAP_POPULATE : 0;
+#endif
+			void* address = ::mmap( nullptr, _size, PROT_READ, flags, fd, 0 );
+			if ( address == MAP_FAILED ) {
+				int error = errno;
+				::close( fd );
+				throw std::system_error( error, std::generic_category(), "cannot map " + path );
+			}
+			_data = static_cast< const char* >( address );
+			// Only hints, a kernel that ignores them changes nothing.
+			::madvise( address, _size, advice );
+#ifdef MADV_HUGEPAGE
+			if ( options.hugePages ) {
+				::madvise( address, _size, MADV_HUGEPAGE );
+			}
+#endif
+		}
+		::close( fd );
+	}
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	~MappedFile() {
+		if ( _data ) {
+			::munmap( const_cast< char* >( _data ), _size );
+		}
+	}
+
+	const char* data() const { return _data; }
+	size_t size() const { return _size; }
+
+private:
+	const char* _data = nullptr;
+	size_t _size = 0;
+};
+
+// An array of T in a mapped file, contiguous like a std::vector.
+template < typename T >
+struct MappedArray : public View {
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using iterator = const T*;
+	using const_iterator = const T*;
+	using sentinel = const T*;
+
+	MappedArray(std::shared_ptr< const MappedFile > file, size_t offset, size_t size, std::uint32_t version = 0)
+			: _file(std::move(file)), _data(reinterpret_cast< const T* >(_file->data() + offset)), _size(size), _version(version) { }
+
+	const T* data() const { return _data; }
+	size_t size() const { return _size; }
+
+	// The version from the header of the file, zero without one.
+	std::uint32_t version() const { return _version; }
+
+	iterator begin() const { return _data; }
+	sentinel end() const { return _data + _size; }
+
+	const T& operator[](size_t i) const { return _data[i]; }
+
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		return consumeArray(_data, _size, sink);
+	}
+
+private:
+	std::shared_ptr< const MappedFile > _file;
+	const T* _data;
+	size_t _size;
+	std::uint32_t _version;
+};
+
+// The lines of a mapped file as string_views into the mapping, without
+// their '\n'. Like std::getline, a final newline does not start another
+// line.
+struct MappedLines : public View {
+	using value_type = std::string_view;
+	using difference_type = std::ptrdiff_t;
+
+	explicit MappedLines(std::shared_ptr< const MappedFile > file) : _file(std::move(file)) { }
+
+	// The current line is [begin, eol), eol is its newline or the end of
+	// the file. The end iterator starts at the end of the file.
+	struct Iterator {
+		using value_type = std::string_view;
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = std::ptrdiff_t;
+		using pointer = ArrowProxy< value_type >;
+		using reference = value_type;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		Iterator(const char* begin, const char* end)
+				: _begin(begin), _eol(begin == end ? end : findByte(begin, end, '\n')), _end(end) { }
+
+		bool operator==(const MappedLines::Iterator& other) const {
+			return _begin == other._begin;
+		}
+
+		bool operator!=(const MappedLines::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		reference operator*() const {
+			return value_type(_begin, static_cast< size_t >(_eol - _begin));
+		}
+
+		Iterator& operator++() {
+			_begin = _eol == _end ? _end : _eol + 1;
+			_eol = _begin == _end ? _end : findByte(_begin, _end, '\n');
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		pointer operator->() const {
+			return pointer{ *(*this) };
+		}
+
+	private:
+		const char* _begin = nullptr;
+		const char* _eol = nullptr;
+		const char* _end = nullptr;
+	};
+
+	using iterator = Iterator;
 	using const_iterator = Iterator;
+	using sentinel = Iterator;
+
+	iterator begin() const {
+		return Iterator(_file->data(), _file->data() + _file->size());
+	}
+
+	sentinel end() const {
+		const char* end = _file->data() + _file->size();
+		return Iterator(end, end);
+	}
+
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		const char* p = _file->data();
+		const char* end = p + _file->size();
+		while (p != end) {
+			const char* eol = findByte(p, end, '\n');
+			if (!push(sink, value_type(p, static_cast< size_t >(eol - p)))) {
+				return false;
+			}
+			p = eol == end ? end : eol + 1;
+		}
+		return true;
+	}
+
+private:
+	std::shared_ptr< const MappedFile > _file;
+};
+
+} // namespace detail
+
+// The bytes of the file at path, mapped instead of read and contiguous,
+// so chunk, sum and friends work on the mapping directly. Throws
+// std::system_error if the file cannot be opened or mapped.
+inline auto mmapBytes( const std::string& path, const MappingOptions& options = {} ) {
+    auto file = std::make_shared< const detail::MappedFile >( path, MADV_SEQUENTIAL, options );
+    size_t size = file->size();
+    return detail::MappedArray< char >{ std::move( file ), 0, size };
+}
+
+// The lines of the file at path as std::string_view slices of the
+// mapping, valid as long as the view or a copy of it lives.
+inline auto mmapLines( const std::string& path, const MappingOptions& options = {} ) {
+    return detail::MappedLines{ std::make_shared< const detail::MappedFile >( path, MADV_SEQUENTIAL, options ) };
+}
+
+// The file at path as a random access array of trivially copyable T,
+// without reading or copying it. With header the file starts with a
+// MappedArrayHeader that gives the element count and a version, the view
+// reports the latter. Without, the whole file is elements. Throws
+// std::runtime_error if the file does not hold such an array.
+template < typename T >
+auto mmapArray( const std::string& path, bool header = false, const MappingOptions& options = {} ) {
+    static_assert( std::is_trivially_copyable_v< T >, "mmapArray needs trivially copyable elements" );
+    static_assert( alignof( T ) <= MappedArrayHeader::dataOffset, "mmapArray elements must not be over-aligned" );
+    auto file = std::make_shared< const detail::MappedFile >( path, MADV_WILLNEED, options );
+    if ( !header ) {
+        if ( file->size() % sizeof( T ) != 0 ) {
+            throw std::runtime_error( path + " is not an array of " + std::to_string( sizeof( T ) ) + " byte elements" );
+        }
+        size_t size = file->size() / sizeof( T );
+        return detail::MappedArray< T >{ std::move( file ), 0, size };
+    }
+
+    MappedArrayHeader found{};
+    if ( file->size() < MappedArrayHeader::dataOffset ) {
+        throw std::runtime_error( path + " is too short for a header" );
+    }
+    std::copy( file->data(), file->data() + sizeof( found ), reinterpret_cast< char* >( &found ) );
+    if ( !std::equal( std::begin( found.magic ), std::end( found.magic ), std::begin( MappedArrayHeader::expectedMagic ) ) ) {
+        throw std::runtime_error( path + " has no array header" );
+    }
+    if ( found.elementSize != sizeof( T ) ) {
+        throw std::runtime_error( path + " holds " + std::to_string( found.elementSize ) + " byte elements, not "
+            + std::to_string( sizeof( T ) ) );
+    }
+    if ( found.count > ( file->size() - MappedArrayHeader::dataOffset ) / sizeof( T ) ) {
+        throw std::runtime_error( path + " is shorter than its header says" );
+    }
+    return detail::MappedArray< T >{ std::move( file ), MappedArrayHeader::dataOffset, static_cast< size_t >( found.count ),
+        found.version };
+}
+
+
+namespace detail {
+
+// Closes a file descriptor it owns.
+class FileDescriptor {
+public:
+	FileDescriptor() = default;
+	explicit FileDescriptor( int fd ) : _fd( fd ) {}
+
+	FileDescriptor( const FileDescriptor& ) = delete;
+	FileDescriptor& operator=( const FileDescriptor& ) = delete;
+
+	~FileDescriptor() {
+		if ( _fd >= 0 ) {
+			::close( _fd );
+		}
+	}
+
+	int get() const { return _fd; }
+
+	void reset( int fd ) {
+		FileDescriptor old( _fd );
+		_fd = fd;
+	}
+
+private:
+	int _fd = -1;
+};
+
+// Frees memory from the aligned operator new.
+template < size_t Alignment >
+struct AlignedDelete {
+	void operator()( char* p ) const {
+		::operator delete( p, std::align_val_t( Alignment ) );
+	}
+};
+
+// Reads a file descriptor on a thread of its own into a ring of blocks,
+// so that the consumer works on one block while the next ones are read.
+// There is a single consumer, each call to next() hands the previous
+// block back to the reader.
+class ReadAhead {
+public:
+	static constexpr size_t alignment = 4096;
+
+	ReadAhead( int fd, size_t blockSize, size_t blocks )
+			: _fd( fd ), _blockSize( blockSize ), _sizes( std::max< size_t >( blocks, 2 ) ),
+			  _buffer( static_cast< char* >( ::operator new( blockSize * _sizes.size(), std::align_val_t( alignment ) ) ) ) {
+		int wake[ 2 ];
+		if ( ::pipe( wake ) != 0 ) {
+			throw std::system_error( errno, std::generic_category(), "cannot create wake-up pipe" );
+		}
+		_wakeRead.reset( wake[ 0 ] );
+		_wakeWrite.reset( wake[ 1 ] );
+		::fcntl( wake[ 0 ], F_SETFD, FD_CLOEXEC );
+		::fcntl( wake[ 1 ], F_SETFD, FD_CLOEXEC );
+		_thread = std::thread( [this] { run(); } );
+	}
 
-	iterator begin() const {
-		if ((_step < 0 && _from < _to) || (_step > 0 && _from > _to)) {
-			return Iterator(_to, _to, _step);
+	ReadAhead( const ReadAhead& ) = delete;
+	ReadAhead& operator=( const ReadAhead& ) = delete;
+
+	// Wakes the reader, also when it waits for a pipe or socket that has
+	// nothing to read, and waits for it to finish.
+	~ReadAhead() {
+		{
+			std::lock_guard< std::mutex > lock( _mutex );
+			_stop = true;
+		}
+		_space.notify_one();
+		char wake = 0;
+		while ( ::write( _wakeWrite.get(), &wake, 1 ) < 0 && errno == EINTR ) {
 		}
-		return Iterator(_from, _to, _step);
+		_thread.join();
 	}
 
-	iterator end() const {
-		return Iterator(_to, _to, _step);
+	// The next block, empty at the end of the input. The previous block
+	// stays valid until this is called again. Throws std::system_error
+	// once the blocks read before a failed read are used up.
+	std::string_view next() {
+		std::unique_lock< std::mutex > lock( _mutex );
+		if ( _holding ) {
+			_holding = false;
+			++_released;
+			_space.notify_one();
+		}
+		_data.wait( lock, [this] { return _filled > _taken || _done; } );
+		if ( _filled == _taken ) {
+			if ( _error != 0 ) {
+				throw std::system_error( _error, std::generic_category(), "cannot read file descriptor" );
+			}
+			return {};
+		}
+		size_t slot = _taken++ % _sizes.size();
+		_holding = true;
+		return std::string_view( _buffer.get() + slot * _blockSize, _sizes[ slot ] );
 	}
 
 private:
-	Integer _from;
-	Integer _to;
-	Integer _step;
+	// Waits until fd has something to read, false if woken to stop first.
+	// Invalid descriptors are left to read() to report.
+	bool readable() {
+		if ( _fd < 0 ) {
+			return true;
+		}
+		pollfd fds[ 2 ] = { { _fd, POLLIN, 0 }, { _wakeRead.get(), POLLIN, 0 } };
+		while ( ::poll( fds, 2, -1 ) < 0 ) {
+			if ( errno != EINTR ) {
+				return true;
+			}
+		}
+		return fds[ 1 ].revents == 0;
+	}
+
+	void run() {
+		while ( true ) {
+			size_t slot;
+			{
+				std::unique_lock< std::mutex > lock( _mutex );
+				_space.wait( lock, [this] { return _stop || _filled - _released < _sizes.size(); } );
+				if ( _stop ) {
+					return;
+				}
+				slot = _filled % _sizes.size();
+			}
+			if ( !readable() ) {
+				return;
+			}
+			// One read per block, so that a slow pipe hands out what it has
+			// instead of waiting for a whole block.
+			ssize_t n;
+			do {
+				n = ::read( _fd, _buffer.get() + slot * _blockSize, _blockSize );
+			} while ( n < 0 && errno == EINTR );
+			int error = n < 0 ? errno : 0;
+			{
+				std::lock_guard< std::mutex > lock( _mutex );
+				if ( n > 0 ) {
+					_sizes[ slot ] = static_cast< size_t >( n );
+					++_filled;
+				} else {
+					_error = error;
+					_done = true;
+				}
+			}
+			_data.notify_one();
+			if ( n <= 0 ) {
+				return;
+			}
+		}
+	}
+
+	int _fd;
+	size_t _blockSize;
+	std::vector< size_t > _sizes;
+	std::unique_ptr< char[], AlignedDelete< alignment > > _buffer;
+	FileDescriptor _wakeRead;
+	FileDescriptor _wakeWrite;
+
+	std::mutex _mutex;
+	std::condition_variable _data;
+	std::condition_variable _space;
+	size_t _filled = 0;
+	size_t _taken = 0;
+	size_t _released = 0;
+	bool _holding = false;
+	bool _done = false;
+	bool _stop = false;
+	int _error = 0;
+	std::thread _thread;
 };
 
-template < typename Integer >
-struct InfiniteSequence : public View {
-	using value_type = Integer;
+// Cuts the blocks of a ReadAhead into lines. A line that spans blocks is
+// copied into a buffer that the cursor reuses, all others point into
+// their block.
+struct LineCursor {
+	// Finds the line after the current one, false at the end.
+	bool next( ReadAhead& reader, std::string_view& line ) {
+		if ( _block.empty() ) {
+			_block = reader.next();
+			if ( _block.empty() ) {
+				return false;
+			}
+		}
+		const char* eol = findByte( _block.data(), _block.data() + _block.size(), '\n' );
+		if ( eol != _block.data() + _block.size() ) {
+			size_t length = static_cast< size_t >( eol - _block.data() );
+			line = _block.substr( 0, length );
+			_block.remove_prefix( length + 1 );
+			return true;
+		}
+
+		_carry.assign( _block.data(), _block.size() );
+		while ( true ) {
+			_block = reader.next();
+			if ( _block.empty() ) {
+				line = _carry;
+				return true;
+			}
+			eol = findByte( _block.data(), _block.data() + _block.size(), '\n' );
+			size_t length = static_cast< size_t >( eol - _block.data() );
+			_carry.append( _block.data(), length );
+			if ( eol != _block.data() + _block.size() ) {
+				line = _carry;
+				_block.remove_prefix( length + 1 );
+				return true;
+			}
+		}
+	}
+
+	std::string_view _block;
+	std::string _carry;
+};
+
+// The blocks of a file descriptor as string_views, each valid until the
+// iterator moves past it. The input is read once, so all copies of the
+// view share one reader and its iterators are input iterators.
+struct FdBytes : public View {
+	using value_type = std::string_view;
 	using difference_type = std::ptrdiff_t;
 
-	explicit InfiniteSequence(Integer from, Integer step) : _from(std::move(from)), _step(std::move(step)) { }
+	explicit FdBytes(std::shared_ptr< ReadAhead > reader) : _reader(std::move(reader)) { }
 
+	// The end iterator has no reader.
 	struct Iterator {
-		using value_type = Integer;
-		using iterator_category = std::forward_iterator_tag;
-		using difference_type = ptrdiff_t;
+		using value_type = std::string_view;
+		using iterator_category = std::input_iterator_tag;
+		using difference_type = std::ptrdiff_t;
 		using pointer = const value_type*;
 		using reference = const value_type&;
 
-		// ForwardIterator must be DefaultConstructible
 		Iterator() = default;
 
-		Iterator(Integer from, Integer step, bool inf) : _from(std::move(from)), _step(std::move(step)), _inf(inf) { }
+		explicit Iterator(ReadAhead* reader) : _reader(reader) {
+			++*this;
+		}
 
-		bool operator==(const InfiniteSequence< value_type >::Iterator& other) const {
-			return _from == other._from && _step == other._step && _inf == other._inf;
+		bool operator==(const FdBytes::Iterator& other) const {
+			return _reader == other._reader;
 		}
 
-		bool operator!=(const InfiniteSequence::Iterator& other) const {
+		bool operator!=(const FdBytes::Iterator& other) const {
 			return !(*this == other);
 		}
 
-		reference operator*() {
-			return _from;
+		reference operator*() const {
+			return _block;
 		}
 
 		Iterator& operator++() {
-			_from += _step;
+			_block = _reader->next();
+			if (_block.empty()) {
+				_reader = nullptr;
+			}
 			return *this;
 		}
 
@@ -404,71 +4161,92 @@ struct InfiniteSequence : public View {
 			return tmp;
 		}
 
-		pointer operator->() {
-			return &(*(*this));
+		pointer operator->() const {
+			return &_block;
 		}
 
 	private:
-		Integer _from;
-		Integer _step;
-		bool _inf;
+		ReadAhead* _reader = nullptr;
+		std::string_view _block;
 	};
 
 	using iterator = Iterator;
 	using const_iterator = Iterator;
+	using sentinel = Iterator;
 
 	iterator begin() const {
-		return Iterator(_from, _step, false);
+		return Iterator(_reader.get());
+	}
+
+	sentinel end() const {
+		return Iterator();
 	}
 
-	iterator end() const {
-		return Iterator(_from, _step, true);
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		for (std::string_view block = _reader->next(); !block.empty(); block = _reader->next()) {
+			if (!push(sink, block)) {
+				return false;
+			}
+		}
+		return true;
 	}
 
 private:
-	Integer _from;
-	Integer _step;
+	std::shared_ptr< ReadAhead > _reader;
 };
 
-template < typename As  >
-struct Take : public View {
-	using value_type = typename As::value_type;
-	using difference_type = typename As::difference_type;
+// The lines of a file descriptor as string_views without their '\n',
+// valid until the iterator moves on. Like std::getline, a final newline
+// does not start another line.
+struct FdLines : public View {
+	using value_type = std::string_view;
+	using difference_type = std::ptrdiff_t;
 
-	explicit Take(As inputView, size_t n) : _inputView(std::move(inputView)), _n(n) { }
+	explicit FdLines(std::shared_ptr< ReadAhead > reader) : _reader(std::move(reader)) { }
 
+	// The end iterator has no reader.
 	struct Iterator {
-		using value_type = typename As::value_type;
-		using iterator_category = std::forward_iterator_tag;
-		using difference_type = ptrdiff_t;
+		using value_type = std::string_view;
+		using iterator_category = std::input_iterator_tag;
+		using difference_type = std::ptrdiff_t;
 		using pointer = const value_type*;
 		using reference = const value_type&;
 
-		// ForwardIterator must be DefaultConstructible
 		Iterator() = default;
 
-		Iterator(typename As::iterator it, size_t n, typename As::iterator end) : _it(std::move(it)), _n(n), _end(std::move(end)) { }
+		explicit Iterator(ReadAhead* reader) : _reader(reader) {
+			++*this;
+		}
 
-		bool operator==(const Take::Iterator& other) const {
-			return _it == other._it && _n == other._n;
-		}	
+		// A line in the buffer of the cursor has to move along with it.
+		Iterator(const Iterator& other) : _reader(other._reader), _cursor(other._cursor), _line(other._line) {
+			rebase(other);
+		}
+
+		Iterator& operator=(const Iterator& other) {
+			_reader = other._reader;
+			_cursor = other._cursor;
+			_line = other._line;
+			rebase(other);
+			return *this;
+		}
+
+		bool operator==(const FdLines::Iterator& other) const {
+			return _reader == other._reader;
+		}
 
-		bool operator!=(const Take::Iterator& other) const {
+		bool operator!=(const FdLines::Iterator& other) const {
 			return !(*this == other);
 		}
 
-		reference operator*() {
-			return *_it;
+		reference operator*() const {
+			return _line;
 		}
 
 		Iterator& operator++() {
-			++_it;
-			--_n;
-			if (_n == 0) {
-				_it = _end;
-			}
-			if (_it == _end) {
-				_n = 0;
+			if (!_cursor.next(*_reader, _line)) {
+				_reader = nullptr;
 			}
 			return *this;
 		}
@@ -479,123 +4257,565 @@ struct Take : public View {
 			return tmp;
 		}
 
-		pointer operator->() {
-			return &(*(*this));
+		pointer operator->() const {
+			return &_line;
 		}
 
 	private:
-		typename As::iterator _it;
-		size_t _n;
-		typename As::iterator _end;
+		void rebase(const Iterator& other) {
+			const char* carry = other._cursor._carry.data();
+			if (_line.data() >= carry && _line.data() < carry + other._cursor._carry.size()) {
+				_line = std::string_view(_cursor._carry.data() + (_line.data() - carry), _line.size());
+			}
+		}
+
+		ReadAhead* _reader = nullptr;
+		LineCursor _cursor;
+		std::string_view _line;
 	};
 
 	using iterator = Iterator;
 	using const_iterator = Iterator;
+	using sentinel = Iterator;
 
 	iterator begin() const {
-		return Iterator(_inputView.begin(), _n, _inputView.end());
+		return Iterator(_reader.get());
 	}
 
-	iterator end() const {
-		if (_n == 0) {
-			return Iterator(_inputView.begin(), 0, _inputView.end());
-		}
+	sentinel end() const {
+		return Iterator();
+	}
 
-		if (_inputView.begin() == _inputView.end()) {
-			return Iterator(_inputView.end(), _n, _inputView.end());
-		}
+	static constexpr bool allocates = true;
 
-		return Iterator(_inputView.end(), 0, _inputView.end());
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		LineCursor cursor;
+		std::string_view line;
+		while (cursor.next(*_reader, line)) {
+			if (!push(sink, line)) {
+				return false;
+			}
+		}
+		return true;
 	}
 
 private:
-	const As _inputView;
-	const size_t _n;
+	std::shared_ptr< ReadAhead > _reader;
 };
 
 } // namespace detail
 
-template < typename T, typename = std::enable_if_t< std::is_base_of_v< detail::View, T > > >
-T view( T t ) { return t; }
+// The contents of fd as they are read, in blocks of at most blockSize
+// bytes. A thread reads up to blocks blocks ahead while the pipeline works
+// on the current one. Suits pipes, sockets and files too large to map.
+// fd stays open and must outlive the view, read errors throw
+// std::system_error. Dropping the view does not wait for more input. A
+// blockSize of zero throws std::invalid_argument.
+inline auto fdBytes( int fd, size_t blockSize = size_t{ 1 } << 20, size_t blocks = 4 ) {
+    detail::checkBlockSize( blockSize, "fdBytes" );
+    return detail::FdBytes{ std::make_shared< detail::ReadAhead >( fd, blockSize, blocks ) };
+}
 
-template < typename T, typename = std::enable_if_t< !std::is_base_of_v< detail::View, T > > >
-auto view( const T& t ) {
-    return detail::ContainerView< T >{ t };
+// The lines of fd, read ahead like fdBytes.
+inline auto fdLines( int fd, size_t blockSize = size_t{ 1 } << 20, size_t blocks = 4 ) {
+    detail::checkBlockSize( blockSize, "fdLines" );
+    return detail::FdLines{ std::make_shared< detail::ReadAhead >( fd, blockSize, blocks ) };
 }
 
-template < typename V, typename Constructor >
-auto operator|( const V& left, detail::RangeBuilder< Constructor > builder ) {
-    return builder.f( view( left ) );
+#endif
+
+namespace detail {
+
+// One record of delimited text. Fields are string_views into the input
+// and are split off lazily, so looking at the first column does not pay
+// for the ones after it. Quoted fields lose their quotes, those with
+// doubled quotes are unescaped into a buffer that the record reuses.
+class CsvRecord {
+public:
+	CsvRecord() = default;
+
+	CsvRecord(std::string_view text, char delim) { reset(text, delim); }
+
+	// The fields of a copy point into the same input, but not into the
+	// buffers of the original.
+	CsvRecord(const CsvRecord& other) { reset(other._text, other._delim); }
+
+	CsvRecord& operator=(const CsvRecord& other) {
+		if (this != &other) {
+			reset(other._text, other._delim);
+		}
+		return *this;
+	}
+
+	// Starts over on another record, keeping the buffers. Unescaped fields
+	// never outgrow the record, so reserving its length up front keeps
+	// them from moving while later fields are split.
+	void reset(std::string_view text, char delim) {
+		_text = text;
+		_delim = delim;
+		_rest = 0;
+		_done = false;
+		_fields.clear();
+		_unescaped.clear();
+		_unescaped.reserve(text.size());
+	}
+
+	// The whole record as it appears in the input.
+	std::string_view text() const { return _text; }
+
+	std::string_view operator[](size_t i) const {
+		splitUntil(i);
+		return _fields[i];
+	}
+
+	std::string_view at(size_t i) const {
+		splitUntil(i);
+		if (i >= _fields.size()) {
+			throw std::out_of_range("CsvRecord::at");
+		}
+		return _fields[i];
+	}
+
+	size_t size() const {
+		splitUntil(std::numeric_limits< size_t >::max());
+		return _fields.size();
+	}
+
+	const std::string_view* begin() const {
+		splitUntil(std::numeric_limits< size_t >::max());
+		return _fields.data();
+	}
+
+	const std::string_view* end() const {
+		return begin() + _fields.size();
+	}
+
+private:
+	void splitUntil(size_t i) const {
+		while (_fields.size() <= i && !_done) {
+			splitNext();
+		}
+	}
+
+	void splitNext() const {
+		const char* p = _text.data() + _rest;
+		const char* end = _text.data() + _text.size();
+		const char* next;
+		if (p != end && *p == '"') {
+			next = splitQuoted(p + 1, end);
+		} else {
+			next = findByte(p, end, _delim);
+			_fields.emplace_back(p, static_cast< size_t >(next - p));
+		}
+		_done = next == end;
+		_rest = _done ? _text.size() : static_cast< size_t >(next - _text.data()) + 1;
+	}
+
+	// Splits the field after an opening quote and returns the delimiter
+	// after it. Text between the closing quote and the delimiter is dropped.
+	const char* splitQuoted(const char* p, const char* end) const {
+		const char* quote = findByte(p, end, '"');
+		if (quote + 1 >= end || quote[1] != '"') {
+			_fields.emplace_back(p, static_cast< size_t >(quote - p));
+		} else {
+			size_t from = _unescaped.size();
+			while (quote + 1 < end && quote[1] == '"') {
+				_unescaped.append(p, quote + 1);
+				p = quote + 2;
+				quote = findByte(p, end, '"');
+			}
+			_unescaped.append(p, quote);
+			_fields.emplace_back(_unescaped.data() + from, _unescaped.size() - from);
+		}
+		return quote == end ? end : findByte(quote + 1, end, _delim);
+	}
+
+	std::string_view _text;
+	char _delim = ',';
+	mutable size_t _rest = 0;
+	mutable bool _done = false;
+	mutable std::vector< std::string_view > _fields;
+	mutable std::string _unescaped;
+};
+
+// End of the record that starts at p: the next newline that is not inside
+// quotes, or end.
+inline const char* csvRecordEnd(const char* p, const char* end) {
+	const char* eol = findByte(p, end, '\n');
+	if (findByte(p, eol, '"') == eol) {
+		return eol;
+	}
+	bool quoted = false;
+	for (; p != end; ++p) {
+		if (*p == '"') {
+			quoted = !quoted;
+		} else if (*p == '\n' && !quoted) {
+			return p;
+		}
+	}
+	return end;
 }
 
-template < typename As, typename F >
-auto map( const As& input, F f ) {
-    return detail::Map{ view( input ), f };
+// The records of delimited text in a contiguous source of chars, split at
+// newlines outside quotes. Lines may end in "\r\n", and like lines a final
+// newline does not start another record. The records are references into
+// the iterator and stay valid until it moves on.
+template < typename As >
+struct CsvRecords : public View {
+	using value_type = CsvRecord;
+	using difference_type = ptrdiff_t;
+
+	static_assert(isContiguous< As >() && std::is_same_v< typename As::value_type, char >,
+			"csvRecords needs a contiguous source of chars");
+
+	CsvRecords(As inputView, char delim) : _inputView(std::move(inputView)), _delim(delim) { }
+
+	const As& source() const { return _inputView; }
+
+	struct Iterator {
+		using value_type = CsvRecord;
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+
+		// ForwardIterator must be DefaultConstructible
+		Iterator() = default;
+
+		Iterator(const char* begin, const char* end, char delim)
+				: _begin(begin), _eol(begin == end ? end : csvRecordEnd(begin, end)), _end(end), _delim(delim) {
+			load();
+		}
+
+		bool operator==(const CsvRecords::Iterator& other) const {
+			return _begin == other._begin;
+		}
+
+		bool operator!=(const CsvRecords::Iterator& other) const {
+			return !(*this == other);
+		}
+
+		reference operator*() const {
+			return _record;
+		}
+
+		Iterator& operator++() {
+			_begin = _eol == _end ? _end : _eol + 1;
+			_eol = _begin == _end ? _end : csvRecordEnd(_begin, _end);
+			load();
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator tmp(*this); // copy
+			++*this;
+			return tmp;
+		}
+
+		pointer operator->() const {
+			return &_record;
+		}
+
+	private:
+		void load() {
+			if (_begin != _end) {
+				_record.reset(csvText(_begin, _eol), _delim);
+			}
+		}
+
+		const char* _begin = nullptr;
+		const char* _eol = nullptr;
+		const char* _end = nullptr;
+		char _delim = ',';
+		CsvRecord _record;
+	};
+
+	using iterator = Iterator;
+	using const_iterator = Iterator;
+	using sentinel = Iterator;
+
+	iterator begin() const {
+		return Iterator(_inputView.data(), _inputView.data() + _inputView.size(), _delim);
+	}
+
+	sentinel end() const {
+		const char* end = _inputView.data() + _inputView.size();
+		return Iterator(end, end, _delim);
+	}
+
+	static constexpr bool allocates = true;
+
+	template < typename Sink >
+	bool consume(Sink&& sink) const {
+		const char* p = _inputView.data();
+		const char* end = p + _inputView.size();
+		CsvRecord record;
+		while (p != end) {
+			const char* eol = csvRecordEnd(p, end);
+			record.reset(csvText(p, eol), _delim);
+			if (!push(sink, static_cast< const CsvRecord& >(record))) {
+				return false;
+			}
+			p = eol == end ? end : eol + 1;
+		}
+		return true;
+	}
+
+private:
+	// The record in [p, eol) without the '\r' of a "\r\n".
+	static std::string_view csvText(const char* p, const char* eol) {
+		if (eol != p && eol[-1] == '\r') {
+			--eol;
+		}
+		return std::string_view(p, static_cast< size_t >(eol - p));
+	}
+
+	As _inputView;
+	char _delim;
+};
+
+} // namespace detail
+
+// The records of delimited text, such as mmapBytes( path ) or a string,
+// each an indexable list of its fields. The fields point into the source
+// and are only split when asked for:
+//
+//   csvRecords( mmapBytes( "log.csv" ) ) | filter( []( const auto& r ) { return r[ 0 ] == "GET"; } )
+template < typename As >
+auto csvRecords( As&& input, char delim = ',' ) {
+    return detail::CsvRecords< detail::ViewOf< As > >{ view( std::forward< As >( input ) ), delim };
 }
 
-template < typename F >
-auto map( F f ) {
+inline auto csvRecords( char delim = ',' ) {
     return detail::makeRangeBuilder( [=]( auto input ){
-        return map( input, f );
+        return detail::CsvRecords< decltype( input ) >{ std::move( input ), delim };
     } );
 }
 
-template < typename As, typename F >
-auto filter( const As& input, F f ) {
-    return detail::Filter{ view( input ), f };
+namespace detail {
+
+// Formatted output is collected in a buffer of this size and leaves it in
+// one write.
+constexpr size_t outputBufferSize = size_t{ 1 } << 20;
+
+// Elements per round of parallel formatting, the output of a round is
+// held in memory until it is written.
+constexpr size_t formatWindow = size_t{ 1 } << 18;
+
+// Appends the number x to out as operator<< on a stream in its default
+// state would, floating point numbers with precision significant digits.
+// The general format never needs more than the digits, a sign, a point
+// and an exponent, so the buffer is sized for that and to_chars cannot
+// run out of room.
+template < typename T >
+void appendNumber( std::string& out, T x, int precision ) {
+	static_assert( std::is_arithmetic_v< T >, "appendNumber formats numbers" );
+	if constexpr ( std::is_same_v< T, bool > ) {
+		out += x ? '1' : '0';
+	} else if constexpr ( std::is_same_v< T, char > || std::is_same_v< T, signed char > || std::is_same_v< T, unsigned char > ) {
+		out += static_cast< char >( x );
+	} else if constexpr ( std::is_integral_v< T > ) {
+		char digits[ 24 ];
+		std::to_chars_result result;
+		if constexpr ( std::is_signed_v< T > ) {
+			result = std::to_chars( digits, digits + sizeof( digits ), static_cast< long long >( x ) );
+		} else {
+			result = std::to_chars( digits, digits + sizeof( digits ), static_cast< unsigned long long >( x ) );
+		}
+		out.append( digits, result.ptr );
+	} else {
+		// Like printf, streams treat a negative precision as the default.
+		precision = precision < 0 ? 6 : precision;
+		size_t room = static_cast< size_t >( precision ) + 32;
+		char digits[ 64 ];
+		if ( room <= sizeof( digits ) ) {
+			auto result = std::to_chars( digits, digits + sizeof( digits ), x, std::chars_format::general, precision );
+			out.append( digits, result.ptr );
+		} else {
+			size_t at = out.size();
+			out.resize( at + room );
+			auto result = std::to_chars( &out[ at ], &out[ at ] + room, x, std::chars_format::general, precision );
+			out.resize( static_cast< size_t >( result.ptr - out.data() ) );
+		}
+	}
 }
 
-template < typename F >
-auto filter( F f ) {
-    return detail::makeRangeBuilder( [=]( auto input ){
-        return filter( input, f );
-    } );
+// Appends x to out as operator<< on a stream in its default state would.
+// False for types that are neither numbers nor strings.
+template < typename T >
+bool appendFormatted( std::string& out, const T& x, int precision ) {
+	if constexpr ( std::is_arithmetic_v< T > ) {
+		appendNumber( out, x, precision );
+	} else if constexpr ( std::is_convertible_v< const T&, std::string_view > ) {
+		out += std::string_view( x );
+	} else {
+		return false;
+	}
+	return true;
 }
 
-template < typename As, typename Bs, typename F >
-auto zipWith( const As& iA, const Bs& iB, F f ) {
-    return detail::ZipWith{ view( iA ), view( iB ),  f };
+template < typename T >
+constexpr bool isFormattable = std::is_arithmetic_v< T > || std::is_convertible_v< const T&, std::string_view >;
+
+// Where writeTo sends its bytes. fallback prints what appendFormatted
+// cannot.
+struct StreamOutput {
+	std::ostream& os;
+
+	// to_chars only matches operator<< on a stream that nobody has set
+	// flags, a width or a locale on.
+	bool plain() const {
+		return os.flags() == ( std::ios_base::skipws | std::ios_base::dec ) && os.width() == 0
+			&& os.getloc() == std::locale::classic();
+	}
+
+	int precision() const { return static_cast< int >( os.precision() ); }
+
+	void write( const char* p, size_t n ) {
+		os.write( p, static_cast< std::streamsize >( n ) );
+	}
+
+	template < typename T >
+	void fallback( const T& x ) {
+		os << x;
+	}
+};
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+
+struct FdOutput {
+	int fd;
+
+	bool plain() const { return true; }
+
+	int precision() const { return 6; }
+
+	void write( const char* p, size_t n ) {
+		while ( n > 0 ) {
+			ssize_t written = ::write( fd, p, n );
+			if ( written < 0 ) {
+				if ( errno == EINTR ) {
+					continue;
+				}
+				throw std::system_error( errno, std::generic_category(), "cannot write file descriptor" );
+			}
+			p += written;
+			n -= static_cast< size_t >( written );
+		}
+	}
+
+	template < typename T >
+	void fallback( const T& ) {
+		static_assert( isFormattable< T >, "writeTo a file descriptor formats numbers, chars and strings" );
+	}
+};
+
+#endif
+
+template < typename V, typename Output >
+void writeFormatted( const V& v, std::string_view sep, Output& out ) {
+	using T = typename V::value_type;
+	int precision = out.precision();
+
+	if constexpr ( isContiguous< V >() && std::is_arithmetic_v< T > ) {
+		// The elements are there already, so formatting them on all cores
+		// runs no functors of the pipeline concurrently.
+		if ( out.plain() && threadPool().concurrency() > 1 && v.size() > parallelGrain ) {
+			std::vector< std::string > parts( 4 * threadPool().concurrency() );
+			for ( size_t from = 0; from < v.size(); from += formatWindow ) {
+				const T* data = v.data() + from;
+				for ( auto& part : parts ) {
+					part.clear();
+				}
+				parallelSlices( std::min( formatWindow, v.size() - from ), [&]( size_t slice, size_t begin, size_t end ) {
+					for ( size_t i = begin; i < end; ++i ) {
+						appendNumber( parts[ slice ], data[ i ], precision );
+						parts[ slice ] += sep;
+					}
+				} );
+				for ( const auto& part : parts ) {
+					out.write( part.data(), part.size() );
+				}
+			}
+			return;
+		}
+	}
+
+	thread_local std::string buffer;
+	buffer.clear();
+	buffer.reserve( outputBufferSize + 256 );
+	bool plain = out.plain();
+	consume( v, [&]( const auto& x ) {
+		if ( !plain || !appendFormatted( buffer, x, precision ) ) {
+			out.write( buffer.data(), buffer.size() );
+			buffer.clear();
+			out.fallback( x );
+		}
+		buffer += sep;
+		if ( buffer.size() >= outputBufferSize ) {
+			out.write( buffer.data(), buffer.size() );
+			buffer.clear();
+		}
+	} );
+	out.write( buffer.data(), buffer.size() );
+	buffer.clear();
 }
 
-template < typename As, typename Bs >
-auto zip( const As& iA, const Bs& iB ) {
-    return detail::ZipWith{ view( iA ), view( iB ), 
-		[]( typename As::value_type vA, typename Bs::value_type vB){ return std::pair {vA, vB}; } };
+} // namespace detail
+
+// Prints every element followed by sep, byte for byte like
+//
+//   for ( const auto& x : input ) { os << x << sep; }
+//
+// but formats numbers with to_chars into a large buffer that is written
+// in one go. Contiguous sources of numbers are formatted on all cores.
+template < typename As >
+void writeTo( const As& input, std::ostream& os, std::string_view sep = " " ) {
+    detail::StreamOutput out{ os };
+    detail::writeFormatted( detail::viewRef( input ), sep, out );
 }
 
-template < typename Integer >
-auto range( Integer from, Integer to, Integer step = 1 ) {
-    return detail::Range{ from, to, step };
+inline auto writeTo( std::ostream& os, std::string_view sep = " " ) {
+    return detail::makeRangeBuilder( [&os, sep]( auto input ){
+        writeTo( input, os, sep );
+    } );
 }
 
-template < typename Integer >
-auto range( Integer to ) {
-    return detail::Range{static_cast<Integer>(0), to, static_cast<Integer>(1) };
+// Every element on a line of its own.
+template < typename As >
+void writeLines( const As& input, std::ostream& os ) {
+    writeTo( input, os, "\n" );
 }
 
-template < typename Integer >
-auto infiniteSequence( Integer from, Integer step = 1 ) {
-	return detail::InfiniteSequence{ from, step };
+inline auto writeLines( std::ostream& os ) {
+    return writeTo( os, "\n" );
 }
 
+#if defined( __unix__ ) || defined( __APPLE__ )
+
+// Like writeTo a stream, but straight to the file descriptor fd with large
+// write calls. Elements have to be numbers, chars or strings. Throws
+// std::system_error if a write fails.
 template < typename As >
-auto enumerate( const As& a ) {
-	return zip(infiniteSequence(static_cast<size_t >(0)), a);
+void writeTo( const As& input, int fd, std::string_view sep = " " ) {
+    detail::FdOutput out{ fd };
+    detail::writeFormatted( detail::viewRef( input ), sep, out );
 }
 
-inline auto enumerate() {
-	return detail::makeRangeBuilder( []( auto a ) {
-		return zip(infiniteSequence(static_cast<size_t >(0)), a);
-	} );
+inline auto writeTo( int fd, std::string_view sep = " " ) {
+    return detail::makeRangeBuilder( [=]( auto input ){
+        writeTo( input, fd, sep );
+    } );
 }
 
 template < typename As >
-auto take( const As& in, size_t n ) {
-	return detail::Take{ view( in ), n };
+void writeLines( const As& input, int fd ) {
+    writeTo( input, fd, "\n" );
 }
 
-inline auto take( size_t n ) {
-	return detail::makeRangeBuilder( [=]( auto input ){ 
-		return detail::Take{ input, n };
-	} );
+inline auto writeLines( int fd ) {
+    return writeTo( fd, "\n" );
 }
+
+#endif
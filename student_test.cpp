@@ -1,7 +1,28 @@
+// instrument() is a pass-through unless these are defined, this test
+// checks the counters.
+#define RANGE_INSTRUMENT
+#define RANGE_INSTRUMENT_TIMING
 #include "range.hpp"
 
 #include <vector>
 #include <list>
+#include <set>
+#include <numeric>
+#include <atomic>
+#include <stdexcept>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
 #include "catch.hpp"
 
 int increment( int x ) { return x + 1; }
@@ -55,7 +76,7 @@ void checkIteratorTraits( Range /*unused*/, Result /*unused*/ ) {
     CHECK( std::is_same_v< typename ItTrait::value_type, Result > );
     CHECK( std::is_same_v< typename ItTrait::pointer, const Result * > );
     CHECK( std::is_same_v< typename ItTrait::reference, const Result & > );
-    CHECK( std::is_same_v< typename ItTrait::iterator_category, std::forward_iterator_tag > );
+    CHECK( std::is_base_of_v< std::forward_iterator_tag, typename ItTrait::iterator_category > );
 
     // Iterator is default-constructible
     typename Range::iterator it;
@@ -604,6 +625,35 @@ TEST_CASE( "Ranges end" ) {
 	}
 }
 
+TEST_CASE( "Floating point ranges" ) {
+	// Only integral ranges count exactly, the others step from + i * step.
+	CHECK( to< std::vector >( range( 0.0, 1.0, 0.25 ) ) == std::vector< double >{ 0.0, 0.25, 0.5, 0.75 } );
+	CHECK( to< std::vector >( range( 1.0, 0.0, -0.5 ) ) == std::vector< double >{ 1.0, 0.5 } );
+	CHECK( range( 0.0, 1.0, 0.1 ).size() == 10 );
+	CHECK( range( 0.0f, 1.0f, -0.1f ).size() == 0 );
+	CHECK( range( 2.5 ).size() == 3 );
+	auto tenths = range( 0.0, 0.3, 0.1 );
+	for ( double x : tenths ) {
+		CHECK( x < 0.3 );
+	}
+	CHECK( tenths.end() - tenths.begin() == 3 );
+
+	auto steps = range( 0.0, 1.0, 0.1 );
+	std::vector< double > iterated( steps.begin(), steps.end() );
+	std::vector< double > consumed;
+	forEach( steps, [&]( double x ) { consumed.push_back( x ); } );
+	CHECK( iterated == consumed );
+	for ( size_t i = 0; i < iterated.size(); ++i ) {
+		CHECK( steps.begin()[ static_cast< std::ptrdiff_t >( i ) ] == iterated[ i ] );
+	}
+	auto eight = steps.begin();
+	for ( int i = 0; i < 8; ++i ) {
+		++eight;
+	}
+	CHECK( *( steps.begin() + 8 ) == *eight );
+	CHECK( *( steps.end() - 2 ) == iterated[ 8 ] );
+}
+
 TEST_CASE( "operator->") {
 	std::vector< std::string > s {"A", "B", "C", "D", "E"};
 	auto r = map(s, []( std::string x ){ return (x + 'X'); });
@@ -704,3 +754,1613 @@ TEST_CASE( "map | filter | take") {
 		}
 	}
 }
+
+TEST_CASE( "Random access iterators" ) {
+	std::vector< int > ints = { 1, 2, 3, 4, 5, 6 };
+	std::vector< int > shorter = { 4, 5, 8, 2 };
+	std::list< int > list = { 1, 2, 3 };
+
+	SECTION( "category is carried through" ) {
+		auto isRandomAccess = []( auto r ) {
+			using It = typename decltype( r )::iterator;
+			return std::is_same_v< typename std::iterator_traits< It >::iterator_category,
+				std::random_access_iterator_tag >;
+		};
+		CHECK( isRandomAccess( range( 10 ) ) );
+		CHECK( isRandomAccess( infiniteSequence( 0 ) ) );
+		CHECK( isRandomAccess( range( 10 ) | map( increment ) ) );
+		CHECK( isRandomAccess( zip( ints, shorter ) ) );
+		CHECK( isRandomAccess( enumerate( ints ) ) );
+		CHECK( isRandomAccess( take( ints, 3 ) ) );
+		CHECK( isRandomAccess( infiniteSequence( 0 ) | take( 3 ) ) );
+		CHECK_FALSE( isRandomAccess( filter( ints, even ) ) );
+		CHECK_FALSE( isRandomAccess( map( list, increment ) ) );
+		CHECK_FALSE( isRandomAccess( zip( ints, list ) ) );
+	}
+
+	SECTION( "range" ) {
+		auto r = range( 1, 10, 2 );
+		REQUIRE( std::distance( r.begin(), r.end() ) == 5 );
+		REQUIRE( r.begin()[ 3 ] == 7 );
+		REQUIRE( *( r.end() - 1 ) == 9 );
+		REQUIRE( r.begin() < r.end() );
+		REQUIRE( *std::lower_bound( r.begin(), r.end(), 6 ) == 7 );
+
+		auto down = range( 2, -5, -2 );
+		REQUIRE( std::distance( down.begin(), down.end() ) == 4 );
+		REQUIRE( *( down.begin() + 2 ) == -2 );
+		REQUIRE( down.begin() < down.end() );
+
+		auto empty = range( 0, 4, -2 );
+		REQUIRE( empty.begin() == empty.end() );
+	}
+
+	SECTION( "map" ) {
+		auto r = range( 100 ) | map( []( int x ) { return x * x; } );
+		REQUIRE( std::distance( r.begin(), r.end() ) == 100 );
+		auto it = r.begin();
+		it += 7;
+		REQUIRE( *it == 49 );
+		REQUIRE( it[ 2 ] == 81 );
+		REQUIRE( it - r.begin() == 7 );
+		REQUIRE( std::binary_search( r.begin(), r.end(), 64 * 64 ) );
+	}
+
+	SECTION( "zip uses the shorter side" ) {
+		auto r = zip( ints, shorter );
+		REQUIRE( std::distance( r.begin(), r.end() ) == 4 );
+		REQUIRE( *( r.end() - 1 ) == std::make_pair( 4, 2 ) );
+		checkRangeEqual( std::vector< std::pair< int, int > >{ { 1, 4 }, { 2, 5 }, { 3, 8 }, { 4, 2 } }, r );
+
+		auto e = enumerate( shorter );
+		REQUIRE( std::distance( e.begin(), e.end() ) == 4 );
+		REQUIRE( e.begin()[ 2 ] == std::make_pair( size_t{ 2 }, 8 ) );
+	}
+
+	SECTION( "take" ) {
+		auto r = take( ints, 4 );
+		REQUIRE( std::distance( r.begin(), r.end() ) == 4 );
+		REQUIRE( r.begin()[ 3 ] == 4 );
+		checkRangeEqual( std::vector< int >{ 1, 2, 3, 4 }, r );
+
+		auto longer = take( ints, 10 );
+		REQUIRE( std::distance( longer.begin(), longer.end() ) == 6 );
+
+		auto inf = infiniteSequence( 5 ) | take( 3 );
+		REQUIRE( *( inf.end() - 1 ) == 7 );
+		checkRangeEqual( std::vector< int >{ 5, 6, 7 }, inf );
+	}
+
+	SECTION( "bidirectional source" ) {
+		auto r = map( list, increment );
+		auto it = r.end();
+		--it;
+		REQUIRE( *it == 4 );
+	}
+}
+
+TEST_CASE( "Sized views" ) {
+	std::vector< int > ints = { 1, 2, 3, 4, 5, 6 };
+	std::vector< int > shorter = { 4, 5, 8, 2 };
+	std::list< int > list = { 1, 2, 3 };
+	DummyRange dummy;
+
+	SECTION( "size matches the number of elements" ) {
+		auto check = []( auto r ) {
+			REQUIRE( detail::isSized< decltype( r ) > );
+			size_t count = 0;
+			for ( auto it = r.begin(); it != r.end(); ++it ) {
+				count++;
+			}
+			REQUIRE( r.size() == count );
+		};
+		check( range( 10 ) );
+		check( range( 1, 10, 2 ) );
+		check( range( 2, -5, -2 ) );
+		check( range( 0, 4, -2 ) );
+		check( map( ints, increment ) );
+		check( map( list, increment ) );
+		check( zip( ints, shorter ) );
+		check( zip( shorter, list ) );
+		check( enumerate( ints ) );
+		check( take( ints, 3 ) );
+		check( take( ints, 10 ) );
+		check( take( list, 2 ) );
+		check( infiniteSequence( 0 ) | take( 7 ) );
+		check( range( 20 ) | map( increment ) | take( 5 ) );
+		check( detail::ContainerView< std::vector< int > >( ints ) );
+	}
+
+	SECTION( "unsized views" ) {
+		CHECK_FALSE( detail::isSized< decltype( filter( ints, even ) ) > );
+		CHECK_FALSE( detail::isSized< decltype( infiniteSequence( 0 ) ) > );
+		CHECK_FALSE( detail::isSized< decltype( map( dummy, increment ) ) > );
+		CHECK_FALSE( detail::isSized< decltype( filter( ints, even ) | take( 2 ) ) > );
+		CHECK_FALSE( detail::isSized< decltype( zip( infiniteSequence( 0 ), infiniteSequence( 1 ) ) ) > );
+	}
+
+	SECTION( "reserve once" ) {
+		auto r = range( 1000 ) | map( increment );
+		std::vector< int > out;
+		out.reserve( detail::size( r ) );
+		auto capacity = out.capacity();
+		for ( int x : r ) {
+			out.push_back( x );
+		}
+		REQUIRE( out.capacity() == capacity );
+		REQUIRE( out.size() == 1000 );
+	}
+}
+
+TEST_CASE( "Sentinel ends" ) {
+	std::vector< int > ints = { 1, 2, 3, 4, 5, 6 };
+	std::list< int > list = { 1, 2, 3, 4 };
+	using VectorIt = std::vector< int >::const_iterator;
+	using ListIt = std::list< int >::const_iterator;
+
+	SECTION( "infinite sequence never ends" ) {
+		auto r = infiniteSequence( 0 );
+		CHECK( std::is_same_v< decltype( r.end() ), detail::Unreachable > );
+		CHECK( r.begin() != r.end() );
+		struct Position { int from, step, value; std::ptrdiff_t index; };
+		CHECK( sizeof( decltype( r.begin() ) ) == sizeof( Position ) );
+	}
+
+	SECTION( "iterators do not carry source ends" ) {
+		CHECK( sizeof( filter( ints, even ).begin() ) == sizeof( void* ) + sizeof( VectorIt ) );
+		CHECK( sizeof( take( list, 2 ).begin() ) == sizeof( ListIt ) + sizeof( size_t ) );
+		CHECK( sizeof( take( ints, 2 ).begin() ) == sizeof( VectorIt ) );
+		CHECK( sizeof( zipWith( list, list, plus ).begin() ) ==
+			2 * sizeof( ListIt ) + sizeof( void* ) + sizeof( std::optional< int > ) );
+	}
+
+	SECTION( "views over sentinels" ) {
+		checkRangeEqual( std::vector< int >{ 0, 2, 4 }, infiniteSequence( 0 ) | filter( even ) | take( 3 ) );
+		checkRangeEqual( std::vector< int >{ 1, 2, 3 }, infiniteSequence( 0 ) | map( increment ) | take( 3 ) );
+		checkRangeEqual( std::vector< int >{ 2, 4 }, list | filter( even ) );
+		checkRangeEqual( std::vector< int >{ 1, 2 }, take( list, 2 ) );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6, 8 }, zipWith( list, ints, plus ) );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6, 8 }, zipWith( ints, list, plus ) );
+		checkRangeEqual( std::vector< int >{}, take( list, 0 ) );
+	}
+
+	SECTION( "common sources stay common" ) {
+		CHECK( detail::isCommon< decltype( filter( ints, even ) ) > );
+		CHECK( detail::isCommon< decltype( map( list, increment ) ) > );
+		CHECK( detail::isCommon< decltype( enumerate( ints ) ) > );
+		CHECK( detail::isCommon< decltype( infiniteSequence( 0 ) | take( 3 ) ) > );
+		CHECK_FALSE( detail::isCommon< decltype( take( list, 3 ) ) > );
+		CHECK_FALSE( detail::isCommon< decltype( infiniteSequence( 0 ) | map( increment ) ) > );
+	}
+}
+
+TEST_CASE( "forEach" ) {
+	std::vector< int > ints = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	std::list< int > list = { 1, 2, 3 };
+
+	auto collect = []( auto r ) {
+		std::vector< typename decltype( r )::value_type > out;
+		bool finished = forEach( r, [&]( const auto& x ) { out.push_back( x ); } );
+		REQUIRE( finished );
+		return out;
+	};
+
+	auto iterate = []( auto r ) {
+		std::vector< typename decltype( r )::value_type > out;
+		for ( auto it = r.begin(); it != r.end(); ++it ) {
+			out.push_back( *it );
+		}
+		return out;
+	};
+
+	SECTION( "matches iteration" ) {
+		auto check = [&]( auto r ) {
+			REQUIRE( collect( r ) == iterate( r ) );
+		};
+		check( range( 10 ) );
+		check( range( 2, -5, -2 ) );
+		check( range( 0, 4, -2 ) );
+		check( ints | map( increment ) );
+		check( ints | filter( even ) );
+		check( list | filter( even ) );
+		check( zip( ints, list ) );
+		check( zip( list, ints ) );
+		check( enumerate( list ) );
+		check( take( ints, 4 ) );
+		check( take( ints, 0 ) );
+		check( take( list, 10 ) );
+		check( infiniteSequence( 0 ) | map( increment ) | filter( even ) | take( 5 ) );
+		check( range( 0, 10, 1 ) | map( []( int x ) { return x + 10; } ) | filter( even ) | take( 3 ) );
+		check( zip( infiniteSequence( 0 ), range( 0, 10, 1 ) | filter( even ) | take( 3 ) ) );
+	}
+
+	SECTION( "early exit" ) {
+		std::vector< int > seen;
+		bool finished = forEach( infiniteSequence( 0 ), [&]( int x ) {
+			seen.push_back( x );
+			return x < 4;
+		} );
+		REQUIRE_FALSE( finished );
+		REQUIRE( seen == std::vector< int >{ 0, 1, 2, 3, 4 } );
+	}
+
+	SECTION( "take stops the source" ) {
+		int calls = 0;
+		auto counted = [&]( int x ) {
+			calls++;
+			return even( x );
+		};
+		int sum = 0;
+		infiniteSequence( 0 ) | filter( counted ) | take( 3 ) | forEach( [&]( int x ) { sum += x; } );
+		REQUIRE( sum == 6 );
+		REQUIRE( calls == 5 );
+	}
+
+	SECTION( "empty source" ) {
+		DummyRange d;
+		REQUIRE( forEach( d, []( int ) { REQUIRE( false ); } ) );
+	}
+}
+
+struct Square {
+    int operator()( int x ) const { return x * x; }
+};
+
+namespace detail {
+template <>
+struct CacheResults< Square > : std::false_type {};
+} // namespace detail
+
+TEST_CASE( "Uncached map" ) {
+	std::vector< int > ints = { 1, 2, 3, 4, 5 };
+	std::vector< std::string > strings = { "a", "b", "c" };
+
+	SECTION( "iterators are small and trivially copyable" ) {
+		auto r = uncachedMap( ints, increment );
+		using It = decltype( r.begin() );
+		CHECK( std::is_trivially_copyable_v< It > );
+		CHECK( sizeof( It ) == 2 * sizeof( void* ) );
+		CHECK( std::is_same_v< std::iterator_traits< It >::reference, int > );
+
+		auto z = uncachedZipWith( ints, ints, plus );
+		CHECK( std::is_trivially_copyable_v< decltype( z.begin() ) > );
+		CHECK( sizeof( z.begin() ) == 3 * sizeof( void* ) );
+	}
+
+	SECTION( "values match the cached map" ) {
+		auto f = []( const std::string& s ) { return s + "X"; };
+		checkRangeEqual( map( strings, f ), uncachedMap( strings, f ) );
+		checkRangeEqual( map( ints, increment ), ints | uncachedMap( increment ) );
+		checkRangeEqual( zipWith( ints, ints, plus ), uncachedZipWith( ints, ints, plus ) );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6 }, ints | uncachedMap( increment ) | filter( even ) );
+		checkRangeEqual( std::vector< int >{ 2, 3 }, ints | uncachedMap( increment ) | take( 2 ) );
+
+		auto r = uncachedMap( strings, f );
+		CHECK( r.begin()->size() == 2 );
+	}
+
+	SECTION( "functor calls" ) {
+		int calls = 0;
+		auto counted = [&]( int x ) {
+			calls++;
+			return x;
+		};
+		auto r = uncachedMap( ints, counted );
+		auto it = r.begin();
+		*it;
+		*it;
+		CHECK( calls == 2 );
+
+		calls = 0;
+		auto c = map( ints, counted );
+		auto cit = c.begin();
+		*cit;
+		*cit;
+		CHECK( calls == 1 );
+	}
+
+	SECTION( "per-functor trait" ) {
+		auto r = map( ints, Square() );
+		CHECK( std::is_trivially_copyable_v< decltype( r.begin() ) > );
+		checkRangeEqual( std::vector< int >{ 1, 4, 9, 16, 25 }, r );
+	}
+}
+
+TEST_CASE( "begin and end are cheap" ) {
+	std::vector< int > a = { 1, 3, 5, 7, 2, 4, 6, 8 };
+	std::vector< int > b = { 1, 1, 1, 2, 2, 2, 2, 2 };
+	int calls = 0;
+	auto counted = [&]( int x ) {
+		calls++;
+		return even( x );
+	};
+
+	SECTION( "filter scans for its first element once" ) {
+		auto r = filter( a, counted );
+		r.begin();
+		CHECK( calls == 5 );
+		r.begin();
+		r.begin();
+		r.end();
+		CHECK( calls == 5 );
+
+		auto copy = r;
+		CHECK( *copy.begin() == 2 );
+		CHECK( calls == 10 );
+	}
+
+	SECTION( "zip of filters | take" ) {
+		auto r = zip( filter( a, counted ), filter( b, counted ) ) | take( 3 );
+		std::vector< std::pair< int, int > > out;
+		for ( auto x : r ) {
+			out.push_back( x );
+		}
+		CHECK( out == std::vector< std::pair< int, int > >{ { 2, 2 }, { 4, 2 }, { 6, 2 } } );
+		// a is scanned up to 6 and b up to its third 2, each element once.
+		CHECK( calls == 7 + 6 );
+	}
+
+	SECTION( "take does not look past its last element" ) {
+		auto r = infiniteSequence( 0 ) | filter( []( int x ) { return x < 3; } ) | take( 3 );
+		checkRangeEqual( std::vector< int >{ 0, 1, 2 }, r );
+	}
+
+	SECTION( "nested zips of filters" ) {
+		auto f = filter( a, counted );
+		auto r = zip( zip( zip( f, f ), zip( f, f ) ), zip( zip( f, f ), zip( f, f ) ) );
+		calls = 0;
+		int count = 0;
+		for ( auto it = r.begin(); it != r.end(); ++it ) {
+			count++;
+		}
+		CHECK( count == 4 );
+		// Eight copies of the filter, each walks the input once.
+		CHECK( calls == 8 * 8 );
+	}
+
+	SECTION( "nested random access zips" ) {
+		auto z = zip( zip( zip( a, b ), zip( a, b ) ), zip( zip( a, b ), zip( a, b ) ) );
+		CHECK( z.end() - z.begin() == 8 );
+		CHECK( z.size() == 8 );
+	}
+}
+
+TEST_CASE( "range counts its elements" ) {
+	auto collect = []( auto r ) {
+		std::vector< typename decltype( r )::value_type > out;
+		for ( auto x : r ) {
+			out.push_back( x );
+		}
+		return out;
+	};
+
+	SECTION( "compile-time step" ) {
+		CHECK( collect( range< 2 >( 1, 10 ) ) == collect( range( 1, 10, 2 ) ) );
+		CHECK( collect( range< -3 >( 10, 0 ) ) == collect( range( 10, 0, -3 ) ) );
+		CHECK( collect( range< -3 >( 0, 10 ) ).empty() );
+		CHECK( collect( range< 1 >( 5, 5 ) ).empty() );
+		CHECK( range< 4 >( 0, 10 ).size() == 3 );
+		CHECK( sizeof( range< 1 >( 0L, 10L ).begin() ) == 2 * sizeof( long ) );
+		CHECK( sizeof( range( 0L, 10L, 1L ).begin() ) == 3 * sizeof( long ) );
+		CHECK( std::is_empty_v< detail::StaticStep< int, 1 > > );
+	}
+
+	SECTION( "near the limits of the type" ) {
+		const int max = std::numeric_limits< int >::max();
+		const int min = std::numeric_limits< int >::min();
+		CHECK( collect( range( max - 5, max, 2 ) ) == std::vector< int >{ max - 5, max - 3, max - 1 } );
+		CHECK( collect( range( min + 5, min, -2 ) ) == std::vector< int >{ min + 5, min + 3, min + 1 } );
+		CHECK( collect( range< 2 >( max - 5, max ) ) == std::vector< int >{ max - 5, max - 3, max - 1 } );
+
+		auto full = range( min, max );
+		CHECK( full.size() == 0xffffffffu );
+		CHECK( *( full.end() - 1 ) == max - 1 );
+
+		auto bytes = range( static_cast< unsigned char >( 0 ), static_cast< unsigned char >( 255 ),
+			static_cast< unsigned char >( 2 ) );
+		CHECK( bytes.size() == 128 );
+		CHECK( collect( bytes ).back() == 254 );
+
+		auto chars = range( static_cast< signed char >( -128 ), static_cast< signed char >( 127 ) );
+		CHECK( collect( chars ).size() == 255 );
+	}
+
+	SECTION( "forEach matches iteration" ) {
+		std::vector< int > out;
+		forEach( range( 7, -8, -3 ), [&]( int x ) { out.push_back( x ); } );
+		CHECK( out == collect( range( 7, -8, -3 ) ) );
+	}
+}
+
+struct CountingVector : std::vector< int > {
+    static int copies;
+
+    using std::vector< int >::vector;
+    CountingVector( const CountingVector& other ) : std::vector< int >( other ) { copies++; }
+    CountingVector( CountingVector&& ) = default;
+    CountingVector& operator=( const CountingVector& other ) {
+        copies++;
+        std::vector< int >::operator=( other );
+        return *this;
+    }
+    CountingVector& operator=( CountingVector&& ) = default;
+};
+
+int CountingVector::copies = 0;
+
+CountingVector makeInts() { return { 1, 2, 3, 4, 5, 6 }; }
+
+TEST_CASE( "Rvalue containers are owned" ) {
+	CountingVector::copies = 0;
+
+	SECTION( "pipelines over temporaries" ) {
+		auto r = makeInts() | map( increment ) | filter( even ) | take( 2 );
+		checkRangeEqual( std::vector< int >{ 2, 4 }, std::move( r ) );
+
+		checkRangeEqual( std::vector< int >{ 2, 3 }, map( makeInts(), increment ) | take( 2 ) );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6 }, filter( makeInts(), even ) );
+		checkRangeEqual( std::vector< int >{ 1, 2 }, take( makeInts(), 2 ) );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6 }, zipWith( makeInts(), std::vector< int >{ 1, 2, 3 }, plus ) );
+
+		int counter = 0;
+		for ( auto [i, c] : std::string( "ABCD" ) | enumerate() ) {
+			CHECK( counter == static_cast< int >( i ) );
+			CHECK( c == "ABCD"[ counter ] );
+			counter++;
+		}
+		CHECK( counter == 4 );
+		CHECK( CountingVector::copies == 0 );
+	}
+
+	SECTION( "owning views move instead of copying" ) {
+		auto r = makeInts() | map( increment );
+		CHECK_FALSE( std::is_copy_constructible_v< decltype( r ) > );
+		auto moved = std::move( r ) | filter( even );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6 }, std::move( moved ) );
+		CHECK( CountingVector::copies == 0 );
+	}
+
+	SECTION( "named owning views are referenced" ) {
+		auto r = makeInts() | map( increment );
+		CHECK( std::is_same_v< decltype( view( r ) ), detail::RefView< decltype( r ) > > );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6 }, r | filter( even ) );
+		checkRangeEqual( std::vector< int >{ 2, 4, 6 }, filter( r, even ) );
+		checkRangeEqual( std::vector< int >{ 3, 4 }, r | map( increment ) | take( 2 ) );
+		CHECK( ( zip( r, r | take( 2 ) ) | to< std::vector >() ) == std::vector< std::pair< int, int > >{ { 2, 2 }, { 3, 3 } } );
+		CHECK( ( r | take( 4 ) ).size() == 4 );
+		CHECK( CountingVector::copies == 0 );
+	}
+
+	SECTION( "lvalues are still referenced" ) {
+		CountingVector v = makeInts();
+		CHECK( std::is_same_v< decltype( view( v ) ), detail::ContainerView< CountingVector > > );
+		auto r = v | map( increment );
+		CHECK( std::is_copy_constructible_v< decltype( r ) > );
+		v[ 0 ] = 10;
+		CHECK( *r.begin() == 11 );
+		CHECK( CountingVector::copies == 0 );
+	}
+}
+
+TEST_CASE( "Collecting into containers" ) {
+	std::vector< int > ints = { 1, 2, 3, 4, 5, 6 };
+	std::string text = "ABCD";
+
+	SECTION( "to vector" ) {
+		auto v = range( 5 ) | map( increment ) | to< std::vector >();
+		CHECK( std::is_same_v< decltype( v ), std::vector< int > > );
+		CHECK( v == std::vector< int >{ 1, 2, 3, 4, 5 } );
+		CHECK( v.capacity() == v.size() );
+
+		auto evens = to< std::vector >( ints | filter( even ) );
+		CHECK( evens == std::vector< int >{ 2, 4, 6 } );
+
+		auto longs = ints | take( 2 ) | to< std::vector< long > >();
+		CHECK( longs == std::vector< long >{ 1, 2 } );
+
+		CHECK( ( infiniteSequence( 0 ) | filter( even ) | take( 3 ) | to< std::vector >() )
+			== std::vector< int >{ 0, 2, 4 } );
+	}
+
+	SECTION( "to string" ) {
+		auto s = text | filter( []( char c ) { return c != 'B'; } ) | to< std::string >();
+		CHECK( s == "ACD" );
+		CHECK( to< std::string >( text ) == text );
+	}
+
+	SECTION( "to associative containers" ) {
+		auto byIndex = text | enumerate() | to< std::unordered_map >();
+		CHECK( std::is_same_v< decltype( byIndex ), std::unordered_map< size_t, char > > );
+		CHECK( byIndex.size() == 4 );
+		CHECK( byIndex.at( 2 ) == 'C' );
+
+		auto ordered = zip( text, ints ) | to< std::map >();
+		CHECK( ordered.at( 'D' ) == 4 );
+
+		auto pairs = zip( text, ints ) | to< std::vector >();
+		CHECK( pairs.size() == 4 );
+		CHECK( pairs[ 1 ] == std::make_pair( 'B', 2 ) );
+	}
+
+	SECTION( "owning pipelines" ) {
+		CountingVector::copies = 0;
+		CHECK( ( makeInts() | map( increment ) | to< std::vector >() ) == std::vector< int >{ 2, 3, 4, 5, 6, 7 } );
+		auto r = makeInts() | filter( even );
+		CHECK( to< std::vector >( r ) == std::vector< int >{ 2, 4, 6 } );
+		CHECK( ( r | to< std::vector >() ) == std::vector< int >{ 2, 4, 6 } );
+		auto owned = makeInts() | map( increment );
+		CHECK( ( owned | to< std::vector >() ) == std::vector< int >{ 2, 3, 4, 5, 6, 7 } );
+		CHECK( ( owned | sum() ) == 27 );
+		CHECK( ( owned | max() ) == 7 );
+		CHECK( ( owned | to< std::vector >() ) == std::vector< int >{ 2, 3, 4, 5, 6, 7 } );
+		CHECK( CountingVector::copies == 0 );
+	}
+
+	SECTION( "collectInto reuses the buffer" ) {
+		std::vector< int > buffer;
+		buffer.reserve( 100 );
+		const int* data = buffer.data();
+		for ( int tick = 0; tick < 5; ++tick ) {
+			range( tick, tick + 10 ) | map( increment ) | collectInto( buffer );
+			CHECK( buffer.size() == 10 );
+			CHECK( buffer.front() == tick + 1 );
+			CHECK( buffer.data() == data );
+		}
+
+		ints | collectInto( buffer );
+		CHECK( buffer == ints );
+		CHECK( buffer.data() == data );
+
+		collectInto( text | take( 2 ), buffer );
+		CHECK( buffer == std::vector< int >{ 'A', 'B' } );
+	}
+
+	SECTION( "bulk copy of contiguous sources" ) {
+		CHECK( detail::canInsertArray< std::vector< int >, detail::ContainerView< std::vector< int > > >() );
+		CHECK( detail::canInsertArray< std::string, detail::OwningView< std::string > >() );
+		CHECK( detail::canInsertArray< std::vector< long >, detail::ContainerView< std::vector< int > > >() );
+		CHECK_FALSE( detail::canInsertArray< std::vector< int >, detail::ContainerView< std::list< int > > >() );
+		CHECK_FALSE( detail::canInsertArray< std::set< int >, detail::ContainerView< std::vector< int > > >() );
+		auto copy = to< std::vector >( ints );
+		CHECK( copy == ints );
+		CHECK( copy.capacity() == ints.size() );
+		auto widened = to< std::vector< long > >( ints );
+		CHECK( widened == std::vector< long >( ints.begin(), ints.end() ) );
+	}
+}
+
+TEST_CASE( "Reductions" ) {
+	std::vector< int > ints = { 4, 8, -3, 7, 1, -3, 9, 0, 9 };
+	std::vector< int > empty;
+	std::list< int > list( ints.begin(), ints.end() );
+
+	SECTION( "reduce" ) {
+		CHECK( reduce( ints, 0, std::plus<>() ) == 32 );
+		CHECK( reduce( empty, 5, std::plus<>() ) == 5 );
+		CHECK( ( range( 1, 11 ) | reduce( 1L, std::multiplies<>() ) ) == 3628800L );
+		CHECK( ( list | filter( even ) | reduce( 100, std::plus<>() ) ) == 112 );
+	}
+
+	SECTION( "sum over every kind of source" ) {
+		CHECK( sum( ints ) == 32 );
+		CHECK( sum( list ) == 32 );
+		CHECK( sum( empty ) == 0 );
+		CHECK( ( range( 1001 ) | sum() ) == 500500 );
+		CHECK( ( range( 100 ) | map( []( int x ) { return x * x; } ) | sum() ) == 328350 );
+		CHECK( ( zipWith( ints, ints, std::multiplies<>() ) | sum() ) == 310 );
+		CHECK( ( infiniteSequence( 1 ) | take( 10 ) | sum() ) == 55 );
+		CHECK( ( ints | filter( even ) | sum() ) == 12 );
+	}
+
+	SECTION( "float kernels agree with a plain loop" ) {
+		for ( size_t n : { 1, 3, 15, 16, 17, 63, 64, 65, 1000, 1001 } ) {
+			std::vector< float > floats;
+			std::vector< double > doubles;
+			for ( size_t i = 0; i < n; ++i ) {
+				floats.push_back( static_cast< float >( ( i * 37 ) % 101 ) - 50.0f );
+				doubles.push_back( static_cast< double >( ( i * 53 ) % 97 ) * 0.5 - 20.0 );
+			}
+			CHECK( sum( floats ) == Approx( std::accumulate( floats.begin(), floats.end(), 0.0 ) ) );
+			CHECK( sum( doubles ) == Approx( std::accumulate( doubles.begin(), doubles.end(), 0.0 ) ) );
+			CHECK( *min( floats ) == *std::min_element( floats.begin(), floats.end() ) );
+			CHECK( *max( doubles ) == *std::max_element( doubles.begin(), doubles.end() ) );
+			auto [low, high] = *minmax( floats );
+			CHECK( low == *std::min_element( floats.begin(), floats.end() ) );
+			CHECK( high == *std::max_element( floats.begin(), floats.end() ) );
+		}
+	}
+
+	SECTION( "accurate float sums" ) {
+		std::vector< float > values( 1000000, 0.1f );
+		values.insert( values.begin(), 1e8f );
+		double exact = 1e8 + 1e6 * static_cast< double >( 0.1f );
+		CHECK( sum( values, Summation::kahan ) == Approx( exact ).epsilon( 1e-7 ) );
+		CHECK( sum( values, Summation::pairwise ) == Approx( exact ).epsilon( 1e-6 ) );
+		CHECK( ( values | take( 3 ) | sum( Summation::pairwise ) ) == 1e8f + 0.1f + 0.1f );
+		CHECK( sum( std::vector< double >{}, Summation::kahan ) == 0.0 );
+	}
+
+	SECTION( "min, max and minmax" ) {
+		CHECK( *min( ints ) == -3 );
+		CHECK( *max( list ) == 9 );
+		CHECK_FALSE( min( empty ) );
+		CHECK_FALSE( ( list | filter( []( int x ) { return x > 100; } ) | max() ) );
+		CHECK( *( range( 10, 0, -1 ) | map( []( int x ) { return ( x - 4 ) * ( x - 4 ); } ) | min() ) == 0 );
+		CHECK( *( ints | minmax() ) == std::make_pair( -3, 9 ) );
+		CHECK( *( list | minmax() ) == std::make_pair( -3, 9 ) );
+		CHECK_FALSE( minmax( empty ) );
+	}
+
+	SECTION( "argmin and argmax" ) {
+		CHECK( *argmin( ints ) == 2 );
+		CHECK( *argmax( ints ) == 6 );
+		CHECK( *( list | argmax() ) == 6 );
+		CHECK( *( range( 5 ) | map( []( int x ) { return -x; } ) | argmin() ) == 4 );
+		CHECK_FALSE( argmin( empty ) );
+	}
+}
+
+TEST_CASE( "Parallel reductions" ) {
+	auto score = []( long x ) { return ( x * 7919 ) % 1009; };
+	long n = 1000000;
+
+	SECTION( "parReduce agrees with reduce" ) {
+		long expected = range( n ) | map( score ) | reduce( 0L, std::plus<>() );
+		CHECK( ( range( n ) | map( score ) | parReduce( 0L, std::plus<>() ) ) == expected );
+		CHECK( ( range( n ) | map( score ) | parReduce( 5L, std::plus<>() ) ) == expected + 5 );
+		CHECK( *( range( n ) | map( score ) | max() ) == ( range( n ) | map( score )
+			| parReduce( 0L, []( long a, long b ) { return std::max( a, b ); } ) ) );
+	}
+
+	SECTION( "parSum over every kind of source" ) {
+		std::vector< double > doubles( 100000 );
+		std::iota( doubles.begin(), doubles.end(), 0.0 );
+		CHECK( parSum( doubles ) == Approx( 99999.0 * 100000.0 / 2 ) );
+		CHECK( ( zipWith( doubles, range( 100000 ), std::minus<>() ) | parSum() ) == 0.0 );
+		CHECK( ( range( 10 ) | parSum() ) == 45 );
+		CHECK( parSum( std::vector< int >{} ) == 0 );
+		std::list< int > list = { 1, 2, 3 };
+		CHECK( ( list | filter( even ) | parSum() ) == 2 );
+	}
+
+	SECTION( "parForEach visits every element once" ) {
+		std::vector< std::atomic< int > > hits( 100000 );
+		parForEach( range( 100000 ), [&]( int i ) { ++hits[ i ]; } );
+		CHECK( std::all_of( hits.begin(), hits.end(), []( const auto& h ) { return h == 1; } ) );
+
+		std::atomic< long > total{ 0 };
+		range( 1000 ) | parForEach( [&]( int i ) {
+			total += range( i ) | parSum();
+		} );
+		CHECK( total == 166167000 );
+	}
+
+	SECTION( "exceptions reach the caller" ) {
+		auto fail = []( long x ) -> long {
+			if ( x == 54321 ) {
+				throw std::runtime_error( "boom" );
+			}
+			return x;
+		};
+		CHECK_THROWS_AS( range( n ) | map( fail ) | parSum(), std::runtime_error );
+		CHECK( ( range( n ) | parSum() ) == n * ( n - 1 ) / 2 );
+	}
+
+	SECTION( "the pool runs every task once" ) {
+		detail::ThreadPool pool( 3 );
+		CHECK( pool.concurrency() == 4 );
+		std::vector< std::atomic< int > > hits( 1000 );
+		pool.run( hits.size(), [&]( size_t i ) {
+			pool.run( 10, [&]( size_t ) { ++hits[ i ]; } );
+		} );
+		CHECK( std::all_of( hits.begin(), hits.end(), []( const auto& h ) { return h == 10; } ) );
+		CHECK_THROWS_AS( pool.run( 100, []( size_t i ) {
+			if ( i == 42 ) {
+				throw std::runtime_error( "boom" );
+			}
+		} ), std::runtime_error );
+	}
+
+	SECTION( "accumulators do not share cache lines" ) {
+		CHECK( alignof( detail::Padded< long > ) == detail::cacheLineSize );
+		CHECK( sizeof( detail::Padded< long > ) == detail::cacheLineSize );
+	}
+}
+
+TEST_CASE( "Chunks and batched maps" ) {
+	std::vector< int > v = { 1, 2, 3, 4, 5, 6, 7 };
+	std::list< int > l( v.begin(), v.end() );
+	auto toVectors = []( const auto& chunks ) {
+		std::vector< std::vector< int > > result;
+		for ( auto block : chunks ) {
+			result.emplace_back( block.begin(), block.end() );
+		}
+		return result;
+	};
+	std::vector< std::vector< int > > expected = { { 1, 2, 3 }, { 4, 5, 6 }, { 7 } };
+
+	SECTION( "contiguous sources are cut into spans" ) {
+		auto chunks = v | chunk( 3 );
+		CHECK( std::is_same_v< std::iterator_traits< decltype( chunks.begin() ) >::iterator_category, std::random_access_iterator_tag > );
+		CHECK( chunks.size() == 3 );
+		CHECK( toVectors( chunks ) == expected );
+		CHECK( ( *chunks.begin() ).data() == v.data() );
+		CHECK( chunks.begin()[ 2 ].size() == 1 );
+		CHECK( chunks.end() - chunks.begin() == 3 );
+		CHECK( ( v | chunk( 7 ) ).size() == 1 );
+		CHECK( ( std::vector< int >{} | chunk( 3 ) ).size() == 0 );
+	}
+
+	SECTION( "blocks must not be empty" ) {
+		CHECK_THROWS_AS( chunk( v, 0 ), std::invalid_argument );
+		CHECK_THROWS_AS( l | chunk( 0 ), std::invalid_argument );
+		CHECK_THROWS_AS( mapBatched( v, 0, []( auto, auto ) {} ), std::invalid_argument );
+	}
+
+	SECTION( "other sources are buffered" ) {
+		CHECK( toVectors( l | chunk( 3 ) ) == expected );
+		CHECK( toVectors( range( 1, 8 ) | chunk( 3 ) ) == expected );
+		CHECK( ( range( 1, 8 ) | chunk( 3 ) ).size() == 3 );
+		CHECK( toVectors( l | filter( even ) | chunk( 2 ) ) == std::vector< std::vector< int > >{ { 2, 4 }, { 6 } } );
+		CHECK( toVectors( infiniteSequence( 1 ) | chunk( 3 ) | take( 3 ) ) == std::vector< std::vector< int > >{ { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } } );
+		CHECK( toVectors( std::list< int >{} | chunk( 3 ) ).empty() );
+	}
+
+	SECTION( "consume matches the iterators" ) {
+		std::vector< std::vector< int > > blocks;
+		forEach( l | chunk( 3 ), [&]( auto block ) { blocks.emplace_back( block.begin(), block.end() ); } );
+		CHECK( blocks == expected );
+		blocks.clear();
+		forEach( v | chunk( 3 ), [&]( auto block ) {
+			blocks.emplace_back( block.begin(), block.end() );
+			return blocks.size() < 2;
+		} );
+		CHECK( blocks.size() == 2 );
+		CHECK( ( v | chunk( 2 ) | map( []( auto block ) { return sum( block ); } ) | to< std::vector >() ) == std::vector< int >{ 3, 7, 11, 7 } );
+	}
+
+	SECTION( "mapBatched calls the functor once per block" ) {
+		int calls = 0;
+		auto twice = [&]( auto in, auto out ) {
+			++calls;
+			for ( size_t i = 0; i < in.size(); ++i ) {
+				out[ i ] = in[ i ] * 2;
+			}
+		};
+		std::vector< int > doubled = { 2, 4, 6, 8, 10, 12, 14 };
+		CHECK( ( v | mapBatched( 3, twice ) | to< std::vector >() ) == doubled );
+		CHECK( calls == 3 );
+
+		calls = 0;
+		std::vector< int > iterated;
+		for ( int x : l | mapBatched( 4, twice ) ) {
+			iterated.push_back( x );
+		}
+		CHECK( iterated == doubled );
+		CHECK( calls == 2 );
+
+		auto halves = range( 5 ) | mapBatched< double >( 2, []( auto in, auto out ) {
+			for ( size_t i = 0; i < in.size(); ++i ) {
+				out[ i ] = in[ i ] / 2.0;
+			}
+		} );
+		CHECK( halves.size() == 5 );
+		checkRangeEqual( std::vector< double >{ 0, 0.5, 1, 1.5, 2 }, halves );
+		CHECK( ( infiniteSequence( 1 ) | mapBatched( 8, twice ) | take( 3 ) | to< std::vector >() ) == std::vector< int >{ 2, 4, 6 } );
+		CHECK( ( std::vector< int >{} | mapBatched( 3, twice ) | to< std::vector >() ).empty() );
+	}
+}
+
+TEST_CASE( "SIMD maps" ) {
+	auto affine = []( auto x ) { return x * 2.0f + 1.0f; };
+
+	SECTION( "agrees with map on every length" ) {
+		for ( size_t n : { 0, 1, 7, 8, 9, 16, 33, 1000 } ) {
+			std::vector< float > v( n );
+			std::iota( v.begin(), v.end(), -3.0f );
+			auto expected = v | map( affine ) | to< std::vector >();
+			CHECK( ( v | mapSimd( affine ) | to< std::vector >() ) == expected );
+			checkRangeEqual( expected, v | mapSimd( affine ) );
+			CHECK( ( v | mapSimd( affine ) | sum() ) == Approx( v | map( affine ) | sum() ) );
+			CHECK( ( v | mapSimd( affine ) | min() ) == ( v | map( affine ) | min() ) );
+			CHECK( ( v | mapSimd( affine ) | max() ) == ( v | map( affine ) | max() ) );
+		}
+		CHECK( detail::HasReduce< decltype( std::vector< float >() | mapSimd( affine ) ), detail::Add >::value );
+	}
+
+	SECTION( "random access and sized" ) {
+		std::vector< double > v = { 1, 2, 3, 4, 5 };
+		auto squares = v | mapSimd( []( auto x ) { return x * x; } );
+		CHECK( squares.size() == 5 );
+		CHECK( squares.begin()[ 3 ] == 16.0 );
+		CHECK( squares.end() - squares.begin() == 5 );
+		CHECK( ( squares | take( 2 ) | to< std::vector >() ) == std::vector< double >{ 1, 4 } );
+		CHECK( ( zip( squares, squares ) | map( []( auto p ) { return p.first + p.second; } ) | to< std::vector >() )
+			== std::vector< double >{ 2, 8, 18, 32, 50 } );
+	}
+
+	SECTION( "integers and early stops" ) {
+		std::vector< int > v( 100 );
+		std::iota( v.begin(), v.end(), 0 );
+		auto shifted = v | mapSimd( []( auto x ) { return 3 - x; } );
+		std::vector< int > firstTen;
+		forEach( shifted, [&]( int x ) {
+			firstTen.push_back( x );
+			return firstTen.size() < 10;
+		} );
+		CHECK( firstTen == std::vector< int >{ 3, 2, 1, 0, -1, -2, -3, -4, -5, -6 } );
+		CHECK( ( shifted | sum() ) == 300 - 4950 );
+	}
+
+	SECTION( "other sources fall back to scalars" ) {
+		std::list< float > l = { 1, 2, 3 };
+		CHECK( ( l | mapSimd( affine ) | to< std::vector >() ) == std::vector< float >{ 3, 5, 7 } );
+		CHECK( ( range( 3 ) | mapSimd( []( auto x ) { return -x; } ) | to< std::vector >() ) == std::vector< int >{ 0, -1, -2 } );
+	}
+}
+
+TEST_CASE( "Contiguous sources" ) {
+	std::vector< int > v = { 1, 2, 3, 4, 5 };
+	std::string s = "hello";
+
+	SECTION( "detected at compile time" ) {
+		CHECK( detail::isContiguous< detail::ContainerView< std::vector< int > > >() );
+		CHECK( detail::isContiguous< detail::OwningView< std::string > >() );
+		CHECK( detail::isContiguous< decltype( v | take( 2 ) ) >() );
+		CHECK_FALSE( detail::isContiguous< detail::ContainerView< std::list< int > > >() );
+		CHECK_FALSE( detail::isContiguous< detail::ContainerView< std::vector< bool > > >() );
+		CHECK_FALSE( detail::isContiguous< decltype( v | map( increment ) ) >() );
+		CHECK_FALSE( detail::isContiguous< decltype( range( 5 ) ) >() );
+	}
+
+	SECTION( "data and size come from the container" ) {
+		auto vs = view( v );
+		CHECK( vs.data() == v.data() );
+		CHECK( vs.size() == 5 );
+		CHECK( view( s ).data() == s.data() );
+		auto prefix = v | take( 3 );
+		CHECK( prefix.data() == v.data() );
+		CHECK( prefix.size() == 3 );
+		CHECK( ( v | take( 10 ) ).size() == 5 );
+	}
+
+	SECTION( "take, zip and collect run on pointers" ) {
+		CHECK( ( v | take( 3 ) | to< std::vector >() ) == std::vector< int >{ 1, 2, 3 } );
+		CHECK( ( v | take( 0 ) | to< std::vector >() ).empty() );
+		CHECK( ( s | take( 4 ) | to< std::basic_string >() ) == "hell" );
+		CHECK( ( v | take( 3 ) | to< std::vector< long > >() ) == std::vector< long >{ 1, 2, 3 } );
+		CHECK( ( v | take( 4 ) | chunk( 3 ) | map( []( auto block ) { return block.data(); } ) | to< std::vector >() )
+			== std::vector< const int* >{ v.data(), v.data() + 3 } );
+		CHECK( ( zipWith( v, s, []( int a, char c ) { return a + c; } ) | to< std::vector >() )
+			== std::vector< int >{ 'h' + 1, 'e' + 2, 'l' + 3, 'l' + 4, 'o' + 5 } );
+		CHECK( ( zipWith( v | take( 2 ), v, std::multiplies<>() ) | to< std::vector >() ) == std::vector< int >{ 1, 4 } );
+
+		std::vector< int > seen;
+		forEach( zipWith( v, v, std::plus<>() ), [&]( int x ) {
+			seen.push_back( x );
+			return x < 6;
+		} );
+		CHECK( seen == std::vector< int >{ 2, 4, 6 } );
+		CHECK( ( v | take( 4 ) | sum() ) == 10 );
+	}
+}
+
+TEST_CASE( "Adjacent stages fuse" ) {
+	std::vector< int > v = { 1, 2, 3, 4, 5, 6 };
+
+	SECTION( "map of map is one map" ) {
+		auto twice = v | map( increment ) | map( []( int x ) { return x * 10; } );
+		CHECK_FALSE( detail::IsMap< decltype( twice )::Source >::value );
+		CHECK( ( twice | to< std::vector >() ) == std::vector< int >{ 20, 30, 40, 50, 60, 70 } );
+		auto thrice = map( map( map( v, increment ), Increment() ), []( int x ) { return std::to_string( x ); } );
+		CHECK_FALSE( detail::IsMap< decltype( thrice )::Source >::value );
+		CHECK( *thrice.begin() == "3" );
+		using Nested = detail::Map< detail::Map< detail::ContainerView< std::vector< int > >, int(*)( int ) >, int(*)( int ) >;
+		CHECK( sizeof( map( map( v, increment ), increment ).begin() ) < sizeof( Nested::iterator ) );
+
+		auto owned = makeInts() | map( increment ) | uncachedMap( Increment() );
+		CHECK( to< std::vector >( owned ) == std::vector< int >{ 3, 4, 5, 6, 7, 8 } );
+	}
+
+	SECTION( "filter of filter is one filter" ) {
+		auto small = v | filter( even ) | filter( []( int x ) { return x < 5; } );
+		CHECK( std::is_same_v< decltype( small )::Source, detail::ContainerView< std::vector< int > > > );
+		CHECK( ( small | to< std::vector >() ) == std::vector< int >{ 2, 4 } );
+		auto oddOnes = filter( filter( v, []( int x ) { return x % 2 == 1; } ), []( int x ) { return x > 1; } );
+		checkRangeEqual( std::vector< int >{ 3, 5 }, oddOnes );
+	}
+
+	SECTION( "take of take keeps the smaller count" ) {
+		auto prefix = v | take( 4 ) | take( 2 );
+		CHECK( std::is_same_v< decltype( prefix ), decltype( v | take( 2 ) ) > );
+		CHECK( ( prefix | to< std::vector >() ) == std::vector< int >{ 1, 2 } );
+		CHECK( ( v | take( 2 ) | take( 4 ) | to< std::vector >() ) == std::vector< int >{ 1, 2 } );
+		CHECK( ( v | take( 2 ) | take( 0 ) | to< std::vector >() ).empty() );
+	}
+
+	SECTION( "a prefix of an infinite sequence is a range" ) {
+		auto firstOdds = infiniteSequence( 1, 2 ) | take( 5 );
+		CHECK( std::is_same_v< decltype( firstOdds ), detail::Range< int > > );
+		CHECK( firstOdds.size() == 5 );
+		CHECK( firstOdds.begin()[ 4 ] == 9 );
+		checkRangeEqual( std::vector< int >{ 1, 3, 5, 7, 9 }, firstOdds );
+		CHECK( ( take( infiniteSequence( 10, -3 ), 3 ) | to< std::vector >() ) == std::vector< int >{ 10, 7, 4 } );
+		CHECK( ( infiniteSequence( 0 ) | take( 0 ) ).size() == 0 );
+		auto halves = infiniteSequence( 0.5 ) | take( 3 );
+		static_assert( detail::IsTake< decltype( halves ) >::value, "floating point sequences are not fused" );
+		CHECK( to< std::vector >( halves ) == std::vector< double >{ 0.5, 1.5, 2.5 } );
+		auto quarters = infiniteSequence( 0.0, 0.5 ) | take( 4 );
+		CHECK( std::distance( quarters.begin(), quarters.end() ) == 4 );
+		CHECK( quarters.begin() < quarters.end() );
+		CHECK( *( quarters.begin() + 3 ) == 1.5 );
+		CHECK( ( infiniteSequence( 0 ) | map( increment ) | take( 3 ) | to< std::vector >() ) == std::vector< int >{ 1, 2, 3 } );
+	}
+
+	SECTION( "sequences whose values do not change still advance" ) {
+		std::vector< int > v{ 1, 2, 3 };
+		auto sevens = zip( infiniteSequence( 7, 0 ), v );
+		CHECK( std::distance( sevens.begin(), sevens.end() ) == 3 );
+		CHECK( to< std::vector >( sevens ) == std::vector< std::pair< int, int > >{ { 7, 1 }, { 7, 2 }, { 7, 3 } } );
+		std::vector< std::pair< int, int > > iterated( sevens.begin(), sevens.end() );
+		CHECK( iterated.size() == 3 );
+
+		std::vector< double > halves;
+		for ( double x : infiniteSequence( 0.5, 0.0 ) | take( 3 ) ) {
+			halves.push_back( x );
+		}
+		CHECK( halves == std::vector< double >{ 0.5, 0.5, 0.5 } );
+
+		std::vector< double > large;
+		for ( double x : infiniteSequence( 1e20, 1.0 ) | take( 3 ) ) {
+			large.push_back( x );
+		}
+		CHECK( large == std::vector< double >{ 1e20, 1e20, 1e20 } );
+	}
+}
+
+namespace {
+
+constexpr std::uint32_t crc32Entry( std::uint32_t byte ) {
+	std::uint32_t c = byte;
+	for ( int k = 0; k < 8; ++k ) {
+		c = ( c & 1 ) ? 0xEDB88320u ^ ( c >> 1 ) : c >> 1;
+	}
+	return c;
+}
+
+constexpr unsigned reverseBits( unsigned x ) {
+	unsigned r = 0;
+	for ( int k = 0; k < 8; ++k ) {
+		r |= ( ( x >> k ) & 1u ) << ( 7 - k );
+	}
+	return r;
+}
+
+template < typename T, size_t N >
+constexpr bool sameElements( const std::array< T, N >& a, const std::array< T, N >& b ) {
+	for ( size_t i = 0; i < N; ++i ) {
+		if ( a[ i ] != b[ i ] ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+constexpr int sumByIterators() {
+	auto evens = range( 10 ) | uncachedMap( []( int x ) { return x * 2; } );
+	int total = 0;
+	for ( auto it = evens.begin(); it != evens.end(); ++it ) {
+		total += *it;
+	}
+	return total + evens.begin()[ 3 ] + static_cast< int >( evens.end() - evens.begin() );
+}
+
+} // namespace
+
+TEST_CASE( "Compile-time pipelines" ) {
+	constexpr auto crc = range( 256u ) | map( crc32Entry ) | to< std::array, 256 >();
+	static_assert( crc[ 0 ] == 0 );
+	static_assert( crc[ 1 ] == 0x77073096u );
+	static_assert( crc[ 255 ] == 0x2D02EF8Du );
+
+	constexpr auto reversed = range( 256u ) | map( reverseBits ) | to< std::array< unsigned char, 256 > >();
+	static_assert( reversed[ 1 ] == 0x80 && reversed[ 0x0F ] == 0xF0 && reversed[ 0xFF ] == 0xFF );
+
+	constexpr auto odds = infiniteSequence( 1, 2 ) | take( 5 ) | to< std::array, 5 >();
+	static_assert( sameElements( odds, std::array< int, 5 >{ 1, 3, 5, 7, 9 } ) );
+
+	constexpr auto multiplesOfThree = infiniteSequence( 1 ) | filter( []( int x ) { return x % 3 == 0; } ) | to< std::array, 4 >();
+	static_assert( sameElements( multiplesOfThree, std::array< int, 4 >{ 3, 6, 9, 12 } ) );
+
+	constexpr auto padded = range( 3 ) | to< std::array, 5 >();
+	static_assert( sameElements( padded, std::array< int, 5 >{ 0, 1, 2, 0, 0 } ) );
+
+	constexpr auto products = zipWith( range( 1, 5 ), infiniteSequence( 10, 10 ), []( int a, int b ) { return a * b; } )
+		| to< std::array, 4 >();
+	static_assert( sameElements( products, std::array< int, 4 >{ 10, 40, 90, 160 } ) );
+
+	static_assert( sumByIterators() == 90 + 6 + 10 );
+
+	CHECK( crc[ 128 ] == crc32Entry( 128 ) );
+	CHECK( ( std::vector< int >{ 4, 5 } | to< std::array, 3 >() ) == std::array< int, 3 >{ 4, 5, 0 } );
+}
+
+TEST_CASE( "Instrumented stages" ) {
+	resetInstruments();
+	std::vector< int > v = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+	SECTION( "filters report their selectivity" ) {
+		auto evens = v | filter( even ) | instrument( "evens" );
+		CHECK( ( evens | to< std::vector >() ) == std::vector< int >{ 2, 4, 6, 8 } );
+		std::string report = instrumentReport();
+		CHECK( report.find( "evens (filter): elements 4, dereferences 4, calls 8, passed 4" ) != std::string::npos );
+		CHECK( report.find( "selectivity 0.5000" ) != std::string::npos );
+	}
+
+	SECTION( "maps report calls per dereference" ) {
+		auto squares = v | map( []( int x ) { return x * x; } ) | instrument( "squares" );
+		int total = 0;
+		for ( auto it = squares.begin(); it != squares.end(); ++it ) {
+			total += *it + *it;
+		}
+		CHECK( total == 2 * 204 );
+		std::string report = instrumentReport();
+		CHECK( report.find( "squares (map): elements 8, dereferences 16, calls 8" ) != std::string::npos );
+		CHECK( report.find( "calls_per_dereference 0.5000" ) != std::string::npos );
+	}
+
+	SECTION( "plain stages count elements and time upstream" ) {
+		auto slow = []( int x ) {
+			volatile int spin = 0;
+			for ( int i = 0; i < 1000; ++i ) {
+				spin = spin + i;
+			}
+			return x;
+		};
+		auto pipeline = v | uncachedMap( slow ) | instrument( "slow" ) | take( 3 ) | instrument( "taken" );
+		CHECK( ( pipeline | to< std::vector >() ) == std::vector< int >{ 1, 2, 3 } );
+		std::string json = instrumentReport( ReportFormat::json );
+		CHECK( json.find( "{\"name\": \"slow\", \"kind\": \"map\", \"elements\": 3, \"dereferences\": 3, \"calls\": 3" ) != std::string::npos );
+		CHECK( json.find( "{\"name\": \"taken\", \"kind\": \"stage\", \"elements\": 3" ) != std::string::npos );
+		CHECK( json.front() == '[' );
+		CHECK( json.find( "\"cycles\": 0," ) == std::string::npos );
+
+		resetInstruments();
+		CHECK( instrumentReport().find( "slow (map): elements 0, dereferences 0, calls 0, passed 0, cycles 0" ) != std::string::npos );
+	}
+
+	SECTION( "instrumented pipelines keep their shape" ) {
+		auto counted = range( 10 ) | instrument( "range" );
+		CHECK( counted.size() == 10 );
+		CHECK( counted.begin()[ 4 ] == 4 );
+		CHECK( std::is_same_v< decltype( counted.begin() )::iterator_category, std::random_access_iterator_tag > );
+		CHECK( ( infiniteSequence( 0 ) | instrument( "infinite" ) | take( 2 ) | to< std::vector >() ) == std::vector< int >{ 0, 1 } );
+	}
+
+	SECTION( "names are escaped in JSON" ) {
+		std::string_view name = "say \"hi\"\\\n";
+		CHECK( to< std::vector >( range( 2 ) | instrument( name ) ).size() == 2 );
+		CHECK( instrumentReport( ReportFormat::json ).find( "{\"name\": \"say \\\"hi\\\"\\\\\\u000a\", \"kind\": \"stage\"" )
+			!= std::string::npos );
+	}
+}
+
+namespace footprint {
+
+using Ints = std::vector< int >;
+using IntsView = detail::ContainerView< Ints >;
+constexpr auto twice = []( int x ) { return x * 2; };
+constexpr auto positive = []( int x ) { return x > 0; };
+
+using RangeMap = decltype( range( 10 ) | map( twice ) );
+using RangeUncachedMap = decltype( range( 10 ) | uncachedMap( twice ) );
+using VectorMap = decltype( std::declval< const Ints& >() | map( twice ) );
+using VectorFilter = decltype( std::declval< const Ints& >() | filter( positive ) );
+using VectorTake = decltype( std::declval< const Ints& >() | take( 3 ) );
+using Dot = decltype( zipWith( std::declval< const Ints& >(), std::declval< const Ints& >(), std::multiplies<>() ) );
+using MapFilterTake = decltype( std::declval< const Ints& >() | map( twice ) | filter( positive ) | take( 3 ) );
+using FiveStages = decltype( std::declval< const Ints& >() | map( twice ) | filter( positive ) | map( increment )
+	| filter( positive ) | take( 3 ) );
+using ListChunks = decltype( std::declval< const std::list< int >& >() | chunk( 4 ) );
+
+// What every pipeline promises, on any platform.
+static_assert( PipelineTraits< IntsView >::contiguous && PipelineTraits< IntsView >::triviallyCopyable );
+static_assert( PipelineTraits< RangeMap >::randomAccess && PipelineTraits< RangeMap >::sized );
+static_assert( PipelineTraits< RangeUncachedMap >::iteratorSize < PipelineTraits< RangeMap >::iteratorSize );
+static_assert( PipelineTraits< VectorTake >::contiguous && PipelineTraits< VectorTake >::common );
+static_assert( !PipelineTraits< VectorFilter >::randomAccess && PipelineTraits< VectorFilter >::common );
+static_assert( PipelineTraits< Dot >::randomAccess && PipelineTraits< Dot >::triviallyCopyable );
+static_assert( !PipelineTraits< MapFilterTake >::common && !PipelineTraits< MapFilterTake >::allocates );
+static_assert( PipelineTraits< decltype( infiniteSequence( 0 ) ) >::infinite );
+static_assert( PipelineTraits< ListChunks >::allocates && !PipelineTraits< ListChunks >::triviallyCopyable );
+static_assert( std::is_same_v< PipelineTraits< VectorFilter >::category, std::forward_iterator_tag > );
+static_assert( std::is_same_v< PipelineTraits< Dot >::category, std::random_access_iterator_tag > );
+
+// Sizes in bytes on x86-64 with libstdc++. A change here means a stage
+// grew or lost an optimization, update the numbers only on purpose.
+#if defined( __x86_64__ ) && defined( __GLIBCXX__ )
+static_assert( PipelineTraits< IntsView >::iteratorSize == 8 );
+static_assert( PipelineTraits< decltype( range( 10 ) ) >::iteratorSize == 16 );
+static_assert( PipelineTraits< RangeMap >::iteratorSize == 32 );
+static_assert( PipelineTraits< RangeUncachedMap >::iteratorSize == 24 );
+static_assert( PipelineTraits< VectorMap >::iteratorSize == 24 );
+static_assert( PipelineTraits< VectorFilter >::iteratorSize == 16 );
+static_assert( PipelineTraits< VectorTake >::iteratorSize == 8 );
+static_assert( PipelineTraits< Dot >::iteratorSize == 32 );
+static_assert( PipelineTraits< MapFilterTake >::iteratorSize == 40 );
+static_assert( PipelineTraits< MapFilterTake >::sentinelSize == 32 );
+static_assert( PipelineTraits< FiveStages >::iteratorSize == 64 );
+#endif
+
+} // namespace footprint
+
+TEST_CASE( "Pipeline traits" ) {
+	CHECK( PipelineTraits< footprint::FiveStages >::viewSize >= PipelineTraits< footprint::MapFilterTake >::viewSize );
+	CHECK( PipelineTraits< footprint::RangeMap >::iteratorSize == sizeof( ( range( 10 ) | map( footprint::twice ) ).begin() ) );
+}
+
+namespace {
+
+// A file in the temporary directory that is removed again at the end of
+// the test.
+struct TempFile {
+	std::string path;
+
+	explicit TempFile( const std::string& contents ) {
+		char name[] = "/tmp/range_test_XXXXXX";
+		int fd = mkstemp( name );
+		REQUIRE( fd >= 0 );
+		REQUIRE( write( fd, contents.data(), contents.size() ) == static_cast< ssize_t >( contents.size() ) );
+		close( fd );
+		path = name;
+	}
+
+	~TempFile() { std::remove( path.c_str() ); }
+};
+
+} // namespace
+
+TEST_CASE( "Memory-mapped files" ) {
+	SECTION( "Lines are slices of the mapping without their newline" ) {
+		TempFile file( "alpha\nbeta\n\ngamma" );
+		auto lines = mmapLines( file.path );
+		std::vector< std::string_view > expected = { "alpha", "beta", "", "gamma" };
+		CHECK( to< std::vector >( lines ) == expected );
+		CHECK( std::vector< std::string_view >( lines.begin(), lines.end() ) == expected );
+	}
+
+	SECTION( "A final newline does not start another line" ) {
+		TempFile file( "one\ntwo\n" );
+		CHECK( to< std::vector >( mmapLines( file.path ) ).size() == 2 );
+		TempFile empty( "" );
+		CHECK( to< std::vector >( mmapLines( empty.path ) ).empty() );
+		CHECK( mmapBytes( empty.path ).size() == 0 );
+		TempFile newline( "\n" );
+		CHECK( to< std::vector >( mmapLines( newline.path ) ) == std::vector< std::string_view >{ "" } );
+	}
+
+	SECTION( "Long lines are scanned a register at a time" ) {
+		std::string contents;
+		std::vector< std::string > expected;
+		for ( size_t length : { 0, 1, 15, 16, 17, 31, 32, 33, 100, 1000 } ) {
+			expected.push_back( std::string( length, 'x' ) + std::to_string( length ) );
+			contents += expected.back() + "\n";
+		}
+		TempFile file( contents );
+		auto lines = mmapLines( file.path ) | map( []( std::string_view line ) { return std::string( line ); } );
+		CHECK( to< std::vector >( lines ) == expected );
+	}
+
+	SECTION( "Composes with the other views" ) {
+		TempFile file( "GET /a 200\nPOST /b 500\nGET /c 404\nGET /d 500\nPUT /e 500\n" );
+		auto errors = mmapLines( file.path )
+			| filter( []( std::string_view line ) { return line.substr( line.size() - 3 ) == "500"; } )
+			| map( []( std::string_view line ) { return line.substr( 0, line.find( ' ' ) ); } )
+			| take( 2 );
+		CHECK( to< std::vector >( errors ) == std::vector< std::string_view >{ "POST", "GET" } );
+
+		// The lines point into the mapping, so it has to outlive them.
+		auto lines = mmapLines( file.path );
+		auto numbered = to< std::vector >( enumerate( lines ) );
+		REQUIRE( numbered.size() == 5 );
+		CHECK( numbered[ 3 ].first == 3 );
+		CHECK( numbered[ 3 ].second == "GET /d 500" );
+	}
+
+	SECTION( "Bytes are contiguous" ) {
+		TempFile file( "abc\ndef\n" );
+		auto bytes = mmapBytes( file.path );
+		static_assert( detail::isContiguous< decltype( bytes ) >(), "a mapping is contiguous" );
+		CHECK( std::string_view( bytes.data(), bytes.size() ) == "abc\ndef\n" );
+		CHECK( to< std::vector >( bytes | filter( []( char c ) { return c == '\n'; } ) ).size() == 2 );
+		CHECK( to< std::vector >( bytes | chunk( 4 ) | map( []( auto span ) { return span.size(); } ) )
+			== std::vector< size_t >{ 4, 4 } );
+	}
+
+	SECTION( "Views keep the mapping alive" ) {
+		TempFile file( "kept\n" );
+		std::string_view line;
+		auto copy = [&] {
+			auto lines = mmapLines( file.path );
+			line = *lines.begin();
+			return lines;
+		}();
+		CHECK( line == "kept" );
+		CHECK( ( *copy.begin() ).data() == line.data() );
+	}
+
+	SECTION( "Missing files throw" ) {
+		CHECK_THROWS_AS( mmapLines( "/nonexistent/range_test" ), std::system_error );
+		CHECK_THROWS_AS( mmapBytes( "/nonexistent/range_test" ), std::system_error );
+	}
+}
+
+TEST_CASE( "CSV records" ) {
+	SECTION( "Fields are split at the delimiter" ) {
+		std::string text = "a,b,c\n1,,3\n";
+		auto records = to< std::vector >( csvRecords( text ) | map( []( const auto& record ) {
+			return std::vector< std::string >( record.begin(), record.end() );
+		} ) );
+		CHECK( records == std::vector< std::vector< std::string > >{ { "a", "b", "c" }, { "1", "", "3" } } );
+	}
+
+	SECTION( "Fields point into the source" ) {
+		std::string text = "key\tvalue\r\nother\tthing";
+		auto records = csvRecords( text, '\t' );
+		auto first = records.begin();
+		CHECK( first->size() == 2 );
+		CHECK( ( *first )[ 1 ] == "value" );
+		CHECK( ( *first )[ 1 ].data() == text.data() + 4 );
+		CHECK( first->text() == "key\tvalue" );
+		CHECK( ( *++first )[ 0 ] == "other" );
+		CHECK( ++first == records.end() );
+	}
+
+	SECTION( "Quoted fields" ) {
+		std::string text = "\"a,b\",\"say \"\"hi\"\"\",\"line\nbreak\",plain\n\"\",x,\n";
+		auto records = csvRecords( text );
+		auto it = records.begin();
+		REQUIRE( it->size() == 4 );
+		CHECK( ( *it )[ 0 ] == "a,b" );
+		CHECK( ( *it )[ 1 ] == "say \"hi\"" );
+		CHECK( ( *it )[ 2 ] == "line\nbreak" );
+		CHECK( ( *it )[ 3 ] == "plain" );
+		++it;
+		CHECK( std::vector< std::string_view >( it->begin(), it->end() ) == std::vector< std::string_view >{ "", "x", "" } );
+		CHECK( ++it == records.end() );
+		CHECK_THROWS_AS( records.begin()->at( 4 ), std::out_of_range );
+	}
+
+	SECTION( "Fields are split lazily" ) {
+		std::string text = "GET,\"unterminated\nPOST,b\n";
+		// The open quote makes the rest of the input one record, the first
+		// field is found without splitting any of it.
+		auto methods = to< std::vector >( csvRecords( text ) | map( []( const auto& record ) { return record[ 0 ]; } ) );
+		CHECK( methods == std::vector< std::string_view >{ "GET" } );
+	}
+
+	SECTION( "Records compose with the other views" ) {
+		TempFile file( "method,path,status\nGET,/a,200\nPOST,/b,500\nGET,/c,500\n" );
+		auto bytes = mmapBytes( file.path );
+		auto failed = csvRecords( bytes ) | filter( []( const auto& record ) { return record[ 2 ] == "500"; } )
+			| map( []( const auto& record ) { return record[ 1 ]; } );
+		CHECK( to< std::vector >( failed ) == std::vector< std::string_view >{ "/b", "/c" } );
+		CHECK( to< std::vector >( bytes | csvRecords() | take( 1 ) )[ 0 ][ 0 ] == "method" );
+	}
+
+	SECTION( "Copies do not share buffers" ) {
+		std::string text = "\"a\"\"b\",c\n";
+		std::vector< detail::CsvRecord > records = to< std::vector >( csvRecords( text ) );
+		REQUIRE( records.size() == 1 );
+		detail::CsvRecord copy = records[ 0 ];
+		records.clear();
+		CHECK( copy[ 0 ] == "a\"b" );
+		CHECK( copy[ 1 ] == "c" );
+	}
+}
+
+namespace {
+
+struct Feature {
+	std::int32_t id;
+	float weight;
+	double score;
+};
+
+template < typename T >
+std::string bytesOf( const T& value ) {
+	return std::string( reinterpret_cast< const char* >( &value ), sizeof( value ) );
+}
+
+std::string featureFile( size_t n ) {
+	std::string contents;
+	for ( size_t i = 0; i < n; ++i ) {
+		contents += bytesOf( Feature{ static_cast< std::int32_t >( i ), static_cast< float >( i ) / 2, static_cast< double >( i * i ) } );
+	}
+	return contents;
+}
+
+} // namespace
+
+TEST_CASE( "Memory-mapped arrays" ) {
+	SECTION( "The whole file is elements" ) {
+		TempFile file( featureFile( 100 ) );
+		auto features = mmapArray< Feature >( file.path );
+		using V = decltype( features );
+		static_assert( detail::isRandomAccess< V::iterator >, "arrays are random access" );
+		static_assert( detail::isContiguous< V >(), "arrays are contiguous" );
+		REQUIRE( features.size() == 100 );
+		CHECK( features[ 42 ].id == 42 );
+		CHECK( features[ 42 ].score == 42.0 * 42.0 );
+		CHECK( features.version() == 0 );
+		CHECK( ( features.end() - 1 )->weight == 49.5f );
+	}
+
+	SECTION( "Composes with the other views" ) {
+		TempFile file( featureFile( 10 ) );
+		auto features = mmapArray< Feature >( file.path, false, MappingOptions{ true, true } );
+		auto ids = features | filter( []( const Feature& f ) { return f.id % 3 == 0; } )
+			| map( []( const Feature& f ) { return f.id; } ) | take( 3 );
+		CHECK( to< std::vector >( ids ) == std::vector< std::int32_t >{ 0, 3, 6 } );
+		auto weighted = zipWith( features, range( 10 ), []( const Feature& f, int i ) { return f.weight * static_cast< float >( i ); } );
+		CHECK( sum( weighted ) == 142.5f );
+		CHECK( sum( features | map( []( const Feature& f ) { return f.score; } ), Summation::pairwise ) == 285.0 );
+	}
+
+	SECTION( "A header gives count and version" ) {
+		std::string contents = bytesOf( MappedArrayHeader::of< std::int64_t >( 3, 7 ) );
+		contents.resize( MappedArrayHeader::dataOffset, '\0' );
+		for ( std::int64_t x : { 5, 6, 7, 8 } ) {
+			contents += bytesOf( x );
+		}
+		TempFile file( contents );
+		auto values = mmapArray< std::int64_t >( file.path, true );
+		CHECK( values.version() == 7 );
+		CHECK( to< std::vector >( values ) == std::vector< std::int64_t >{ 5, 6, 7 } );
+		CHECK( reinterpret_cast< std::uintptr_t >( values.data() ) % alignof( std::int64_t ) == 0 );
+
+		CHECK_THROWS_AS( mmapArray< std::int32_t >( file.path, true ), std::runtime_error );
+		CHECK_THROWS_AS( mmapArray< std::int64_t >( TempFile( featureFile( 4 ) ).path, true ), std::runtime_error );
+	}
+
+	SECTION( "Files that are no arrays throw" ) {
+		TempFile file( "12345" );
+		CHECK_THROWS_AS( mmapArray< std::int32_t >( file.path ), std::runtime_error );
+		CHECK( mmapArray< char >( file.path ).size() == 5 );
+
+		std::string contents = bytesOf( MappedArrayHeader::of< std::int32_t >( 100 ) );
+		contents.resize( MappedArrayHeader::dataOffset + 8, '\0' );
+		TempFile truncated( contents );
+		CHECK_THROWS_AS( mmapArray< std::int32_t >( truncated.path, true ), std::runtime_error );
+
+		TempFile empty( "" );
+		CHECK( mmapArray< double >( empty.path ).size() == 0 );
+		CHECK_THROWS_AS( mmapArray< double >( empty.path, true ), std::runtime_error );
+	}
+}
+
+namespace {
+
+// The read end of a pipe that a thread fills with contents, a few bytes
+// per write. Closes both ends at the end of the test.
+struct Pipe {
+	int fds[ 2 ];
+	std::thread writer;
+
+	Pipe( std::string contents, size_t piece ) {
+		REQUIRE( pipe( fds ) == 0 );
+		writer = std::thread( [this, contents, piece] {
+			for ( size_t i = 0; i < contents.size(); i += piece ) {
+				size_t n = std::min( piece, contents.size() - i );
+				if ( write( fds[ 1 ], contents.data() + i, n ) != static_cast< ssize_t >( n ) ) {
+					break;
+				}
+			}
+			close( fds[ 1 ] );
+		} );
+	}
+
+	int readEnd() const { return fds[ 0 ]; }
+
+	~Pipe() {
+		writer.join();
+		close( fds[ 0 ] );
+	}
+};
+
+} // namespace
+
+TEST_CASE( "File descriptor sources" ) {
+	std::string contents;
+	std::vector< std::string > expected;
+	for ( int i = 0; i < 200; ++i ) {
+		expected.push_back( std::string( static_cast< size_t >( i % 23 ), 'a' + static_cast< char >( i % 26 ) ) + std::to_string( i ) );
+		contents += expected.back() + "\n";
+	}
+	auto strings = []( const auto& lines ) {
+		return to< std::vector >( lines | map( []( std::string_view line ) { return std::string( line ); } ) );
+	};
+
+	SECTION( "Blocks add up to the input" ) {
+		Pipe pipe( contents, 100 );
+		std::string read;
+		for ( std::string_view block : fdBytes( pipe.readEnd(), 64, 3 ) ) {
+			CHECK( block.size() <= 64 );
+			read += block;
+		}
+		CHECK( read == contents );
+	}
+
+	SECTION( "Lines from a pipe, across block boundaries" ) {
+		Pipe pipe( contents, 7 );
+		CHECK( strings( fdLines( pipe.readEnd(), 16, 2 ) ) == expected );
+	}
+
+	SECTION( "Lines from a file through iterators" ) {
+		TempFile file( contents + "no newline" );
+		int fd = open( file.path.c_str(), O_RDONLY );
+		REQUIRE( fd >= 0 );
+		auto lines = fdLines( fd, 5, 4 );
+		std::vector< std::string > read;
+		for ( auto it = lines.begin(); it != lines.end(); ++it ) {
+			read.emplace_back( *it );
+		}
+		close( fd );
+		expected.push_back( "no newline" );
+		CHECK( read == expected );
+	}
+
+	SECTION( "Copies of an iterator keep their line" ) {
+		Pipe pipe( "a long line\nshort\n", 3 );
+		auto lines = fdLines( pipe.readEnd(), 4, 2 );
+		auto it = lines.begin();
+		auto copy = it;
+		CHECK( *copy == "a long line" );
+		CHECK( *it++ == "a long line" );
+		CHECK( *it == "short" );
+	}
+
+	SECTION( "Composes with the other views" ) {
+		Pipe pipe( contents, 4096 );
+		auto numbered = fdLines( pipe.readEnd(), 256 ) | filter( []( std::string_view line ) { return line.size() > 20; } )
+			| map( []( std::string_view line ) { return std::stoi( std::string( line.substr( line.find_first_of( "0123456789" ) ) ) ); } )
+			| take( 3 );
+		CHECK( to< std::vector >( numbered ) == std::vector< int >{ 19, 20, 21 } );
+	}
+
+	SECTION( "Stopping early does not wait for the writer" ) {
+		int fds[ 2 ];
+		REQUIRE( pipe( fds ) == 0 );
+		std::string first = "first\nsecond\n";
+		REQUIRE( write( fds[ 1 ], first.data(), first.size() ) == static_cast< ssize_t >( first.size() ) );
+		// The write end stays open, so the reader blocks once it has read
+		// the two lines.
+		CHECK( strings( fdLines( fds[ 0 ] ) | take( 1 ) ) == std::vector< std::string >{ "first" } );
+		{
+			auto idle = fdBytes( fds[ 0 ] );
+		}
+		close( fds[ 1 ] );
+		close( fds[ 0 ] );
+	}
+
+	SECTION( "Empty input and read errors" ) {
+		Pipe pipe( "", 1 );
+		CHECK( to< std::vector >( fdLines( pipe.readEnd() ) ).empty() );
+		CHECK_THROWS_AS( to< std::vector >( fdBytes( -1 ) ), std::system_error );
+		CHECK_THROWS_AS( fdBytes( pipe.readEnd(), 0 ), std::invalid_argument );
+		CHECK_THROWS_AS( fdLines( pipe.readEnd(), 0 ), std::invalid_argument );
+	}
+}
+
+namespace {
+
+// What for ( x : input ) os << x << sep would print.
+template < typename As >
+std::string streamed( const As& input, std::string_view sep, std::ostringstream os = std::ostringstream() ) {
+	for ( const auto& x : input ) {
+		os << x << sep;
+	}
+	return os.str();
+}
+
+template < typename As >
+std::string written( const As& input, std::string_view sep, std::ostringstream os = std::ostringstream() ) {
+	writeTo( input, os, sep );
+	return os.str();
+}
+
+} // namespace
+
+TEST_CASE( "Formatted output" ) {
+	SECTION( "Numbers print like operator<<" ) {
+		std::vector< int > ints = { 0, -1, 42, std::numeric_limits< int >::min(), std::numeric_limits< int >::max() };
+		CHECK( written( ints, " " ) == streamed( ints, " " ) );
+
+		std::vector< double > doubles = { 0.0, -0.0, 1.0, 0.1, -2.5, 1e-5, 1e-4, 123456.0, 1234567.0, 1.0 / 3,
+			std::numeric_limits< double >::max(), std::numeric_limits< double >::denorm_min(),
+			std::numeric_limits< double >::infinity(), -std::numeric_limits< double >::infinity(), std::nan( "" ) };
+		CHECK( written( doubles, ", " ) == streamed( doubles, ", " ) );
+
+		std::vector< float > floats = { 0.5f, 3.14159265f, -1e20f, 1e-30f };
+		CHECK( written( floats, "\n" ) == streamed( floats, "\n" ) );
+
+		std::vector< unsigned long long > large = { std::numeric_limits< unsigned long long >::max() };
+		CHECK( written( large, "" ) == streamed( large, "" ) );
+	}
+
+	SECTION( "Chars, bools and strings" ) {
+		std::vector< char > chars = { 'a', 'b', ' ' };
+		CHECK( written( chars, "|" ) == "a|b| |" );
+		std::vector< std::string > strings = { "one", "", "three" };
+		CHECK( written( strings, "\n" ) == streamed( strings, "\n" ) );
+		CHECK( written( range( 3 ) | map( []( int x ) { return x % 2 == 0; } ), " " ) == "1 0 1 " );
+		std::vector< unsigned char > bytes = { 'x', 'y' };
+		CHECK( written( bytes, "" ) == streamed( bytes, "" ) );
+	}
+
+	SECTION( "Streams with settings are honoured" ) {
+		std::vector< double > doubles = { 1.0, 2.25, 1.0 / 3 };
+		std::ostringstream fixed;
+		fixed << std::fixed << std::setprecision( 2 );
+		std::ostringstream fixedToo;
+		fixedToo << std::fixed << std::setprecision( 2 );
+		CHECK( written( doubles, " ", std::move( fixed ) ) == streamed( doubles, " ", std::move( fixedToo ) ) );
+
+		std::ostringstream precise;
+		precise << std::setprecision( 17 );
+		std::ostringstream preciseToo;
+		preciseToo << std::setprecision( 17 );
+		CHECK( written( doubles, " ", std::move( precise ) ) == streamed( doubles, " ", std::move( preciseToo ) ) );
+
+		// More elements than parallel formatting needs, and more digits
+		// than a double holds.
+		std::vector< double > many( 5000 );
+		for ( size_t i = 0; i < many.size(); ++i ) {
+			many[ i ] = ( static_cast< double >( i ) - 2500.5 ) / 3 * std::pow( 10.0, static_cast< double >( i % 40 ) - 20 );
+		}
+		for ( int digits : { 0, 17, 40, 100 } ) {
+			std::ostringstream wide;
+			wide << std::setprecision( digits );
+			std::ostringstream wideToo;
+			wideToo << std::setprecision( digits );
+			CHECK( written( many, " ", std::move( wide ) ) == streamed( many, " ", std::move( wideToo ) ) );
+		}
+
+		std::vector< std::pair< int, int > > pairs = { { 1, 2 } };
+		std::ostringstream os;
+		writeLines( pairs | map( []( auto p ) { return p.first + p.second; } ), os );
+		CHECK( os.str() == "3\n" );
+	}
+
+	SECTION( "Pipelines end in writeTo" ) {
+		std::ostringstream os;
+		range( 1, 10 ) | filter( []( int x ) { return x % 2 == 1; } ) | writeTo( os, "," );
+		CHECK( os.str() == "1,3,5,7,9," );
+
+		std::vector< double > many( 300000 );
+		std::iota( many.begin(), many.end(), -1000.0 );
+		for ( auto& x : many ) {
+			x /= 7;
+		}
+		CHECK( written( many, " " ) == streamed( many, " " ) );
+		std::ostringstream lines;
+		many | writeLines( lines );
+		CHECK( lines.str() == streamed( many, "\n" ) );
+	}
+
+	SECTION( "File descriptors" ) {
+		std::vector< int > input( 100000 );
+		std::iota( input.begin(), input.end(), -50000 );
+		char name[] = "/tmp/range_test_XXXXXX";
+		int fd = mkstemp( name );
+		REQUIRE( fd >= 0 );
+		input | map( []( int x ) { return x * 3; } ) | writeTo( fd );
+		writeLines( std::vector< std::string >{ "", "end" }, fd );
+		close( fd );
+
+		auto bytes = mmapBytes( name );
+		std::remove( name );
+		CHECK( std::string( bytes.data(), bytes.size() ) == streamed( input | map( []( int x ) { return x * 3; } ), " " ) + "\nend\n" );
+		CHECK_THROWS_AS( writeTo( input, -1 ), std::system_error );
+	}
+}